@@ -0,0 +1,149 @@
+#include "aggregate.h"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <stdexcept>
+
+#include "hash.h"
+
+namespace expenses {
+
+	// text is a function call only if the function is known; any
+	// other text, e.g. Amount(CAD), is a column, which is summed
+	AggregateSpec AggregateSpec::parse(const std::string& text)
+	{
+		AggregateSpec spec;
+		spec.label = text;
+		spec.column = text;
+
+		size_t open = text.find('(');
+		if (open == std::string::npos || open == 0 || text.back() != ')') {
+			return spec; // a plain column is summed
+		}
+
+		AggregateSpec call = spec;
+		std::string fn = text.substr(0, open);
+		call.column = text.substr(open + 1, text.size() - open - 2);
+		std::transform(fn.begin(), fn.end(), fn.begin(), ::tolower);
+		if (fn == "sum") {
+			call.kind = Sum;
+		} else if (fn == "count") {
+			call.kind = Count;
+		} else if (fn == "avg") {
+			call.kind = Avg;
+		} else if (fn == "min") {
+			call.kind = Min;
+		} else if (fn == "max") {
+			call.kind = Max;
+		} else if (fn == "median") {
+			call.kind = Quantile;
+			call.q = 0.5;
+		} else if (fn == "distinct") {
+			call.kind = Distinct;
+		} else if (fn == "cells") {
+			call.kind = Cells;
+		} else if (fn[0] == 'p' && fn.size() > 1 &&
+				   std::all_of(fn.begin() + 1, fn.end(), ::isdigit) &&
+				   Aggregate::toNumber(fn.substr(1), call.q) && call.q <= 100) {
+			call.kind = Quantile;
+			call.q /= 100;
+		} else {
+			return spec;
+		}
+
+		return call;
+	}
+
+	Aggregate::Aggregate(const AggregateSpec& spec, bool exact) :
+		kind{spec.kind}, q{spec.q},
+		min{std::numeric_limits<double>::infinity()},
+		max{-std::numeric_limits<double>::infinity()},
+		quantiles{exact}, distinct{exact}
+	{
+	}
+
+	bool Aggregate::toNumber(std::string_view str, double& value)
+	{
+		if (str.empty()) {
+			return false;
+		}
+
+		try {
+			value = stod(std::string{str});
+		} catch(const std::invalid_argument& e) {
+			return false;
+		} catch(const std::out_of_range& e) {
+			return false;
+		}
+		return true;
+	}
+
+	void Aggregate::add(std::string_view value)
+	{
+		if (value.empty()) {
+			return;
+		}
+
+		// cells and distinct take any value, the others
+		// only numbers:
+		if (kind == AggregateSpec::Cells) {
+			++count;
+			return;
+		}
+		if (kind == AggregateSpec::Distinct) {
+			distinct.add(hashString(value));
+			return;
+		}
+
+		double dVal;
+		if (!toNumber(value, dVal)) {
+			return;
+		}
+
+		++count;
+		sum += dVal;
+		min = std::min(min, dVal);
+		max = std::max(max, dVal);
+		if (kind == AggregateSpec::Quantile) {
+			quantiles.add(dVal);
+		}
+	}
+
+	void Aggregate::merge(const Aggregate& other)
+	{
+		count += other.count;
+		sum += other.sum;
+		min = std::min(min, other.min);
+		max = std::max(max, other.max);
+		if (kind == AggregateSpec::Quantile) {
+			quantiles.merge(other.quantiles);
+		} else if (kind == AggregateSpec::Distinct) {
+			distinct.merge(other.distinct);
+		}
+	}
+
+	double Aggregate::result() const
+	{
+		const double none = std::numeric_limits<double>::quiet_NaN();
+		switch(kind) {
+		case AggregateSpec::Sum:
+			return sum;
+		case AggregateSpec::Count:
+		case AggregateSpec::Cells:
+			return count;
+		case AggregateSpec::Avg:
+			return count ? sum / count : none;
+		case AggregateSpec::Min:
+			return count ? min : none;
+		case AggregateSpec::Max:
+			return count ? max : none;
+		case AggregateSpec::Quantile:
+			return quantiles.quantile(q);
+		case AggregateSpec::Distinct:
+			return distinct.estimate();
+		}
+		return none;
+	}
+
+} // namespace expenses
@@ -0,0 +1,62 @@
+#ifndef AGGREGATE_H_
+#define AGGREGATE_H_
+
+#include <string>
+#include <string_view>
+
+#include "sketch.h"
+
+// Summary aggregates over the values of a column
+namespace expenses {
+
+	// a summary column as given on the command line: either a
+	// plain column name (summed) or function(column) where the
+	// function is one of sum, count, avg, min, max, median, pNN
+	// (the NNth percentile, e.g. p95), distinct or cells. All but
+	// distinct and cells use only the values that are numbers;
+	// cells counts the values that are not empty
+	struct AggregateSpec
+	{
+		enum Kind { Sum, Count, Avg, Min, Max, Quantile, Distinct, Cells };
+
+		Kind kind{Sum};
+		double q{0};
+		std::string column;
+		std::string label;
+
+		static AggregateSpec parse(const std::string& text);
+
+		// counts are printed without decimals
+		bool isCount() const { return kind == Count || kind == Distinct || kind == Cells; }
+
+		// the values need not be numbers
+		bool isText() const { return kind == Distinct || kind == Cells; }
+	};
+
+	// the state of one aggregate; it takes constant memory
+	// and partial aggregates can be merged
+	class Aggregate
+	{
+	public:
+		Aggregate(const AggregateSpec& spec, bool exact);
+
+		void add(std::string_view value);
+		void merge(const Aggregate& other);
+		double result() const;
+
+		static bool toNumber(std::string_view str, double& value);
+
+	private:
+		AggregateSpec::Kind kind;
+		double q;
+		uint64_t count{0};
+		double sum{0};
+		double min;
+		double max;
+		QuantileSketch quantiles;
+		DistinctSketch distinct;
+	};
+
+} // namespace expenses
+
+#endif
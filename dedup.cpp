@@ -0,0 +1,89 @@
+#include "dedup.h"
+
+#include "hash.h"
+
+namespace expenses {
+
+	Deduplicator::Deduplicator() :
+		slots(1024)
+	{
+	}
+
+	void Deduplicator::bind(const std::vector<int>& indices)
+	{
+		this->indices = indices;
+	}
+
+	uint64_t Deduplicator::keyOf(const Row& row) const
+	{
+		// chaining the hashes of the fields keeps ("ab", "c")
+		// and ("a", "bc") apart:
+		uint64_t hash = indices.size();
+		for(int index : indices) {
+			if (index < static_cast<int>(row.size())) {
+				hash = hashString(row[index], hash);
+			} else {
+				hash = mix64(hash + 1);
+			}
+		}
+		return hash ? hash : 1; // 0 is a free slot
+	}
+
+	bool Deduplicator::isDuplicate(const Row& row)
+	{
+		if (!insert(keyOf(row))) {
+			++duplicates;
+			return true;
+		}
+		return false;
+	}
+
+	void Deduplicator::insertNew(uint64_t hash)
+	{
+		if (2 * (used + 1) > slots.size()) {
+			grow();
+		}
+
+		// no need to compare, just find a free slot:
+		size_t mask = slots.size() - 1;
+		size_t i = hash & mask;
+		while (slots[i] != 0) {
+			i = (i + 1) & mask;
+		}
+		slots[i] = hash;
+		++used;
+	}
+
+	bool Deduplicator::insert(uint64_t hash)
+	{
+		// keep the load under 1/2:
+		if (2 * (used + 1) > slots.size()) {
+			grow();
+		}
+
+		size_t mask = slots.size() - 1;
+		for(size_t i = hash & mask; ; i = (i + 1) & mask) {
+			if (slots[i] == hash) {
+				return false;
+			}
+			if (slots[i] == 0) {
+				slots[i] = hash;
+				++used;
+				return true;
+			}
+		}
+	}
+
+	void Deduplicator::grow()
+	{
+		std::vector<uint64_t> old(slots.size() * 2);
+		old.swap(slots);
+		used = 0;
+		for(uint64_t hash : old) {
+			if (hash != 0) {
+				insertNew(hash);
+			}
+		}
+	}
+
+} // namespace expenses
@@ -0,0 +1,44 @@
+#ifndef DEDUP_H_
+#define DEDUP_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "row.h"
+
+// Drops the rows whose key columns repeat those of an earlier
+// row, e.g. the transactions shared by overlapping exports
+namespace expenses {
+	class Deduplicator
+	{
+	public:
+		Deduplicator();
+
+		// the positions in the rows of the key columns; must be
+		// called before any row is checked
+		void bind(const std::vector<int>& indices);
+
+		// true if the key of row was seen before; the key is
+		// remembered otherwise
+		bool isDuplicate(const Row& row);
+		size_t getDuplicates() const { return duplicates; }
+
+	private:
+		uint64_t keyOf(const Row& row) const;
+		bool insert(uint64_t hash);
+		void insertNew(uint64_t hash);
+		void grow();
+
+		std::vector<int> indices;
+
+		// open addressing set of the 64 bit hashes of the keys,
+		// 0 marking a free slot; only the hashes are kept
+		std::vector<uint64_t> slots;
+		size_t used{0};
+
+		size_t duplicates{0};
+	};
+} // namespace expenses
+
+#endif
@@ -1,11 +1,19 @@
 #include "exp_processor.h"
 
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <set>
-#include <fstream>
 #include <algorithm>
 
+#include "dedup.h"
 #include "options.h"
+#include "input_reader.h"
+#include "plan.h"
+#include "reconcile.h"
+#include "summary.h"
+#include "window.h"
 
 namespace expenses
 {
@@ -37,47 +45,96 @@ namespace expenses
 		return os;
 	}
 	
-	Processor::Processor(const std::string& filename, char fieldDelimiter) :
-		db {}
+	const std::string Processor::defaultCodeColumn{"Code"};
+
+	Processor::Processor(const std::string& filename, char fieldDelimiter,
+						 const ColumnList& columns, Deduplicator* dedup,
+						 const HeadingsCheck& check) :
+		db {}, filename{filename}
 {
-	std::fstream fin{filename};
-	if (!fin) {
-		throw std::ios_base::failure{filename + " does not exist"};
+	readRows(filename, fieldDelimiter, columns,
+			 [this](const Row& row) { db.push_back(store(row, arena)); }, dedup, check);
+}
+
+	// copy the row into the arena: its cells are laid out
+	// one after the other in a single allocation
+	Row Processor::store(const Row& row, std::pmr::memory_resource& arena)
+	{
+		size_t len = 0;
+		for(const auto& cell : row) {
+			len += cell.size();
+		}
+
+		char* text = static_cast<char*>(arena.allocate(len ? len : 1, 1));
+		Row stored{&arena};
+		stored.reserve(row.size());
+		for(const auto& cell : row) {
+			std::memcpy(text, cell.data(), cell.size());
+			stored.emplace_back(text, cell.size());
+			text += cell.size();
+		}
+		return stored;
 	}
 
-	for(std::string line; std::getline(fin, line);) {
-		Row row = fillRow(line, fieldDelimiter);
-		
-		// skip any empty row:
-		if (row.empty()) {
-			continue;
+	void Processor::readRows(const std::string& filename, char fieldDelimiter,
+							 const ColumnList& columns, const RowSink& addRow,
+							 Deduplicator* dedup, const HeadingsCheck& check)
+	{
+		// compressed input is decompressed on a separate thread
+		// while the rows are being parsed here:
+		InputReader fin{filename};
+
+		// positions of the columns to keep, resolved once the
+		// headings are known:
+		IndexList fields;
+		bool allFields = columns.empty();
+		bool isHeadings = true;
+
+		// the same line and row are reused for all the lines:
+		Row row;
+		for(std::string line; fin.getline(line);) {
+			// skip any empty row:
+			if (!fillRow(line, fieldDelimiter, fields, allFields || isHeadings, row)) {
+				continue;
+			}
+
+			if (isHeadings && check && !check(row)) {
+				return;
+			}
+
+			if (isHeadings && !allFields) {
+				fields = resolveColumns(row, columns);
+				Row headings;
+				for(auto index : fields) {
+					headings.push_back(row[index]);
+				}
+				row.swap(headings);
+			}
+
+			// dedup is bound to the headings by check:
+			if (dedup && !isHeadings && dedup->isDuplicate(row)) {
+				continue;
+			}
+
+			isHeadings = false;
+			addRow(row);
+		}
+
+		if (isHeadings) {
+			throw std::runtime_error{filename + " has no headings"};
 		}
-		
-		db.push_back(row);
 	}
-}
 
 	// print the codes; codes can be in any
 	// column position
 	void Processor::printCodes() const {
-		Row codes = getAllCodeValues();
+		ColumnList codes = getAllCodeValues();
 		for(auto code : codes) {
 			std::cout << code << "\n";
 		}
 	}
 
-	Processor::Row
-	Processor::getAllCodeValuesByColumn(const std::string& column) const {
-
-		int index = findIndex(column);
-		if (index < 0) {
-			return Row{};
-		}
-
-		return getAllCodeValuesByIndex(index);
-	}
-
-	Processor::Row Processor::getAllCodeValuesByIndex(int colIndex) const {
+	ColumnList Processor::getAllCodeValuesByIndex(int colIndex) const {
 		std::set<std::string> uniqueCodes;
 		for(int i = 1, e = db.size(); i != e; ++i) {
 			const Row& row = db[i];
@@ -85,42 +142,13 @@ namespace expenses
 				continue;
 			}
 		
-			uniqueCodes.insert(row[colIndex]);
+			uniqueCodes.emplace(row[colIndex]);
 		}
 	
-		return Row{uniqueCodes.begin(), uniqueCodes.end()};
+		return ColumnList{uniqueCodes.begin(), uniqueCodes.end()};
 	}
 
 	
-	int Processor::findIndex(const std::string& column, bool ignoreCase) const
-	{
-		// the first row contains column heading:
-		if (db.empty()) {
-			return -1; // column does not exist
-		}
-
-		int sz = column.size();
-		const Row& headings = db[0];
-	
-		// ignore case ?
-		auto it = ignoreCase ? std::find_if(headings.begin(), headings.end(),
-											[sz, &column](const std::string& heading) {
-												if (static_cast<int>(heading.size()) != sz) {
-													return false;
-												}
-					 
-												for(int i=0; i < sz; ++i) {
-													if (toupper(heading[i]) != toupper(column[i])) {
-														return false;
-													}
-												}
-												return true;
-											})
-			: std::find(headings.begin(), headings.end(), column); 
-
-		return it != headings.end() ? it - headings.begin() : -1;
-	}
-
 	void Processor::reverse(Row& fields)
 	{
 		for(int i=0, j=fields.size() - 1; i < j; ++i, --j) {
@@ -128,7 +156,7 @@ namespace expenses
 		}
 	}
 
-	void Processor::printLine(int len) const
+	void Processor::printLine(int len)
 	{
 		for(int i=0; i < len; ++i) {
 			std::cout << '=';
@@ -136,22 +164,6 @@ namespace expenses
 		std::cout << '\n';
 	}
 
-	Processor::IndexList Processor::getIndicesForColumns(const Row& columns) const
-	{
-		if (columns.empty()) {
-			return {};
-		}
-	
-		IndexList iList(columns.size());
-		const Row& headings = getHeadings();
-		for(int i = 0, e = columns.size(); i != e; ++i) {
-			auto it = std::find(headings.begin(), headings.end(), columns[i]);
-			iList[i] = it != headings.end() ? it - headings.begin() : -1;
-		}
-
-		return iList;
-	}
-
 	bool Processor::isInteger(const std::string& str, int& nbr)
 	{
 		try {
@@ -237,7 +249,7 @@ namespace expenses
 				continue; // skip the bad ones:
 			}
 
-			const std::string& value = row[index];
+			std::string value{row[index]};
 			// use a simple test to check whether the
 			// cell contains a date value:
 			int ival = 0;
@@ -251,90 +263,225 @@ namespace expenses
 		return os.str();
 	}
 	
-	void Processor::sortDB(const Row& orderedBy)
+	void Processor::sortDB(const IndexList& orderedBy)
 	{
-		IndexList iList = getIndicesForColumns(orderedBy);
-		auto compare = [&iList](const Row& a, const Row& b) {
-			std::string serializedRowA = serializeRow(a, iList);
-			std::string serializedRowB = serializeRow(b, iList);			
-			return serializedRowA < serializedRowB;
-		};
+		if (db.size() < 2) {
+			return;
+		}
 
-		// exclude the headings:
-		std::sort(db.begin() + 1, db.end(), compare);
+		// serialize each row once rather than on every comparison;
+		// rows with the same key keep their order in the file:
+		std::vector<std::pair<std::string, int>> keys;
+		keys.reserve(db.size() - 1);
+		for(int r = 1, e = db.size(); r != e; ++r) {
+			keys.emplace_back(serializeRow(db[r], orderedBy), r);
+		}
+		std::sort(keys.begin(), keys.end());
+
+		// the headings stay first:
+		DB sorted;
+		sorted.reserve(db.size());
+		sorted.push_back(std::move(db[0]));
+		for(const auto& key : keys) {
+			sorted.push_back(std::move(db[key.second]));
+		}
+		db.swap(sorted);
 	}
 	
-	void Processor::printDetailsForColumns(const Row& columns, const Row& orderedBy)
+	void Processor::printDetails(const Plan& plan) const
 	{	
 		// make the format to use to print the data
 		Format<std::string> sfmt(10, std::ios_base::right, ' ');
-		IndexList iList = getIndicesForColumns(columns);
+		Format<double> fmt{2, 10, std::ios_base::fixed};
+		fmt.fill(' ');
+		IndexList iList = plan.getDetailIndices();
+
+		// the windows are computed per code over the rows, in order:
+		Window window = plan.makeWindow();
+		bool hasWindows = !window.getSpecs().empty();
 
-		// sort the data by the columns provided
-		if (!orderedBy.empty()) {
-			sortDB(orderedBy);
-		}
-		
 		// now that we have all the indices, we can traverse the DB:
 		std::cout << "\n";
 		std::string sep{" | "};
-		for(auto row : db) {			
+		for(int r = 0, e = db.size(); r != e; ++r) {
+			const Row& row = db[r];
+			// the windows first, as they throw on a bad date:
+			std::vector<double> values;
+			if (r > 0 && hasWindows) {
+				values = window.next(row);
+			}
+
 			// let's print the row according to the order of the
 			// columns given by the user instead of the order in
 			// which the columns appear in the input file:
 			std::string prefix = "";
 			for(int i = 0, e = iList.size(); i != e; ++i) {
-				std::cout << prefix << sfmt(row[iList[i]]);
+				// unknown columns and short rows are blank:
+				int index = iList[i];
+				std::cout << prefix << sfmt(index >= 0 && index < static_cast<int>(row.size()) ?
+											row[index] : Cell{});
 				prefix = sep;
 			}
+
+			// followed by the windows, in the order of the rows:
+			if (r == 0) {
+				for(const auto& spec : window.getSpecs()) {
+					std::cout << prefix << sfmt(spec.label);
+					prefix = sep;
+				}
+			} else {
+				for(double value : values) {
+					if (std::isnan(value)) {
+						std::cout << prefix << sfmt("");
+					} else {
+						std::cout << prefix << fmt(value);
+					}
+					prefix = sep;
+				}
+			}
 			std::cout << "\n";
 		}
 	}
 
-	void Processor::printSummaryForColumns(const Row& columns,
-										   const std::string& codeHeading) const
+	void Processor::printReconciliation(const Processor& other,
+										const Reconciler& reconciler) const
+	{
+		Format<std::string> sfmt(10, std::ios_base::right, ' ');
+		const std::string sep{" | "};
+		auto printRow = [&sfmt, &sep](const Row& row, std::string prefix) {
+			for(const auto& field : row) {
+				std::cout << prefix << sfmt(field);
+				prefix = sep;
+			}
+		};
+
+		// only the columns matched on were loaded:
+		Reconciler::Result result = reconciler.match(db, other.db);
+
+		std::cout << "\nMatched: " << result.matched.size() << "\n";
+		if (!result.matched.empty()) {
+			printRow(db[0], "");
+			printRow(other.db[0], " || ");
+			std::cout << "\n";
+		}
+		for(const auto& match : result.matched) {
+			printRow(db[match.first], "");
+			printRow(other.db[match.second], " || ");
+			std::cout << "\n";
+		}
+
+		auto printUnmatched = [&printRow](const Processor& pr, const std::vector<int>& rows) {
+			std::cout << "\nUnmatched in " << pr.filename << ": " << rows.size() << "\n";
+			if (!rows.empty()) {
+				printRow(pr.db[0], "");
+				std::cout << "\n";
+			}
+			for(int r : rows) {
+				printRow(pr.db[r], "");
+				std::cout << "\n";
+			}
+		};
+		printUnmatched(*this, result.unmatchedLeft);
+		printUnmatched(other, result.unmatchedRight);
+	}
+
+	Summary Processor::summarize(const Plan& plan) const
+	{
+		// aggregate all the columns in a single pass over
+		// the rows split between the threads:
+		Summary summary = plan.makeSummary();
+		if (!db.empty()) {
+			summary.addRows(db.begin() + 1, db.end(), plan.getThreads());
+		}
+		return summary;
+	}
+
+	Summary Processor::streamSummary(const Plan& plan, Deduplicator* dedup,
+									 const HeadingsCheck& check)
+	{
+		// the summary is made once the plan is bound to the headings
+		std::unique_ptr<Summary> summary;
+
+		// the rows are aggregated by batches of a chunk per thread,
+		// the chunks being the same as when all the rows are loaded
+		unsigned threads = plan.getThreads();
+		std::pmr::monotonic_buffer_resource arena;
+		Table batch;
+		auto flush = [&summary, &batch, &arena, threads]() {
+			summary->addRows(batch.begin(), batch.end(), threads);
+			batch.clear();
+			arena.release();
+		};
+
+		readRows(plan.getFilename(), plan.getSeparator(), plan.getLoadColumns(),
+				 [&](const Row& row) {
+					 if (!summary) {
+						 summary.reset(new Summary{plan.makeSummary()});
+						 return; // the headings
+					 }
+
+					 batch.push_back(store(row, arena));
+					 if (batch.size() == threads * Summary::chunkSize) {
+						 flush();
+					 }
+				 }, dedup, check);
+		flush();
+
+		return std::move(*summary);
+	}
+
+	void Processor::printSummary(const Summary& summary)
 	{
 		// make the format to use to print the data
 		Format<double> fmt{2, 10, std::ios_base::fixed};
 		fmt.fill(' ');
 		Format<std::string> sfmt(5, std::ios_base::left);
 		sfmt.fill(' ');
+
+		const auto& specs = summary.getSpecs();
+		auto printValues = [&fmt, &sfmt, &specs](const std::vector<double>& values,
+												 const std::string& sep) {
+			for(int i = 0, e = values.size(); i != e; ++i) {
+				// no value to aggregate, as in the windows:
+				if (std::isnan(values[i])) {
+					std::cout << sfmt("") << sep;
+					continue;
+				}
+
+				// counts have no decimals:
+				fmt.setPrecision(specs[i].isCount() ? 0 : 2);
+				std::cout << fmt(values[i]) << sep;
+			}
+		};
 	
 		const std::string sep{" | "};
-		std::string finCodeColumn = codeHeading.empty() ? defaultFinCodeColumn :
-			codeHeading;
-
-		int len = columns.size() * (fmt.getWidth() + sep.size()) + fmt.getWidth() + 2;
+		int len = specs.size() * (fmt.getWidth() + sep.size()) + fmt.getWidth() + 2;
 		// print the headings:
 		std::cout << "\n";
 		printLine(len);
 		sfmt.setWidth(fmt.getWidth());
-		std::cout << sfmt(finCodeColumn) << sep;
-		for(auto heading : columns) {
-			std::cout << sfmt(heading) << sep;
+		std::cout << sfmt(summary.getCodeColumn()) << sep;
+		for(const auto& spec : specs) {
+			std::cout << sfmt(spec.label) << sep;
 		}
 		std::cout << "\n";
 		printLine(len);
 
-		// print the sums:
-		Processor::DBRow codes = getAllCodeValuesByColumn(finCodeColumn);
-		for(auto code : codes) {
-			if (code.empty()) {
-				continue; // skip the xls summary
-			}
+		// print the aggregates by code:
+		for(const auto& code : summary.getCodes()) {
 			std::cout << sfmt(code) << sep;
-			for(const auto& column : columns) {
-				std::cout << fmt(getColumnTotal(column, code)) << sep;
-			}
+			printValues(summary.getResults(code), sep);
 			std::cout << "\n";
 		}
 
 		// print the summary for the selected colums:
+		bool sumsOnly = std::all_of(specs.begin(), specs.end(),
+									[](const AggregateSpec& spec) {
+										return spec.kind == AggregateSpec::Sum;
+									});
 		printLine(len);
-		std::cout << sfmt("Sum") << sep;
-		for(const auto& column : columns) {
-			std::cout << fmt(getColumnTotal(column)) << sep;
-		}
+		std::cout << sfmt(sumsOnly ? "Sum" : "All") << sep;
+		printValues(summary.getTotals(), sep);
 		std::cout << "\n";
 		printLine(len);
 	}
@@ -342,7 +489,7 @@ namespace expenses
 	void Processor::dump() const
 	{
 		for(auto row : db) {
-			for(const std::string& field : row) {
+			for(Cell field : row) {
 				std::cout << field << ": ";
 			}
 			std::cout << "\n";
@@ -350,88 +497,168 @@ namespace expenses
 		std::cout << "No of rows processed: " << db.size() << "\n";
 	}
 
-	Processor::Row Processor::fillRow(const std::string& line, char delimiter)
+	// split the line into views of its fields keeping only the
+	// ones at the given positions (sorted) unless all fields are
+	// wanted; the other fields are skipped
+	bool Processor::fillRow(const std::string& line, char delimiter,
+							const IndexList& fields, bool allFields, Row& row)
 	{
 		// empty rows are ignored
-		std::istringstream is{line};
-		Row row;
-		std::string field;
+		row.clear();
+		const std::string_view text{line};
 		bool isEmpty = true;
-		while(std::getline(is, field, delimiter)) {
-			isEmpty = isEmpty && field.empty();
-			row.push_back(field);
+		auto want = fields.begin();
+		for(size_t pos = 0, column = 0; pos < line.size(); ++column) {
+			size_t next = line.find(delimiter, pos);
+			if (next == std::string::npos) {
+				next = line.size();
+			}
+			isEmpty = isEmpty && next == pos;
+
+			if (allFields) {
+				row.push_back(text.substr(pos, next - pos));
+			} else if (want != fields.end() && *want == static_cast<int>(column)) {
+				row.push_back(text.substr(pos, next - pos));
+				++want;
+			} else if (want == fields.end() && !isEmpty) {
+				break; // nothing else is needed from this line
+			}
+			pos = next + 1;
 		}
 
-		// return empty row iff all fields are empty:
-		return isEmpty ? Row{} : row;
+		// the row is empty iff all fields are empty:
+		return !isEmpty;
 	}
 
-	double Processor::getColumnTotal(const std::string& column,
-									 const std::string& code) const
+	// the positions of the given columns in the headings in
+	// the order in which they appear in the file; unknown
+	// columns are ignored
+	Processor::IndexList Processor::resolveColumns(const Row& headings,
+												   const ColumnList& columns)
 	{
-		int colIndex = findIndex(column);
-		if (colIndex < 0) {
-			return 0;
+		IndexList fields;
+		for(int i = 0, e = headings.size(); i != e; ++i) {
+			if (std::find(columns.begin(), columns.end(), headings[i]) != columns.end()) {
+				fields.push_back(i);
+			}
 		}
+		return fields;
+	}
 
-		int catCodeIndex = findIndex(defaultFinCodeColumn);
-		if (catCodeIndex < 0) {
-			return 0;
-		}
-		
-		bool skipRow = !code.empty();
-		double total = 0;
-		// skip the headings:
-		for(int i=1, e = db.size();  i != e; ++i) {
-			auto row = db[i];
-			if (row.empty() || static_cast<int>(row.size()) <= colIndex) {
-				continue; // skip any empty or short row;
+	void Processor::processExpenses(const Options& options)
+	{
+		// check the options and compile them once; the columns
+		// are resolved as soon as the headings are read so that
+		// an unknown one is reported before the rows are loaded
+		Plan plan{options};
+		const bool reconcile = plan.getStrategy() == Plan::Strategy::Reconcile;
+		const char sep = plan.getSeparator();
+		auto ignore = [](const Row&) {};
+		auto readHeadings = [&plan, sep, &ignore]() {
+			readRows(plan.getFilename(), sep, plan.getLoadColumns(), ignore, nullptr,
+					 [&plan](const Row& headings) { plan.bind(headings); return false; });
+		};
+		auto readOtherHeadings = [&plan, sep, &ignore]() {
+			readRows(plan.getOtherFilename(), sep, plan.getOtherLoadColumns(),
+					 ignore, nullptr,
+					 [&plan](const Row& headings) { plan.bindOther(headings); return false; });
+		};
+		if (options.explain()) {
+			// only the headings are read:
+			if (reconcile) {
+				readOtherHeadings();
 			}
+			readHeadings();
+			plan.explain(std::cout);
+			return;
+		}
 
-			const std::string& catCode = row[catCodeIndex];
-			if (skipRow && catCode != code) {
-				continue;
-			}
-		
-			const std::string& value = row[colIndex];
-			if (value.empty()) {
-				continue;
+		// when reconciling, both files are bound before either is
+		// loaded; the standard input can only be read once, so it
+		// is bound as it is loaded:
+		if (reconcile) {
+			if (plan.getOtherFilename() != "-") {
+				readOtherHeadings();
 			}
-		
-			// convert it to a double precision floating point;
-			double dVal;
-			try {
-				dVal = stod(row[colIndex]);
-			} catch(std::invalid_argument& e) {				
-				continue;
+			if (plan.getFilename() != "-") {
+				readHeadings();
 			}
-		
-			total += dVal;
 		}
 
-		return total;
-	}
+		// drop the rows repeated in the input, in both files
+		// when reconciling:
+		std::unique_ptr<Deduplicator> dedup;
+		std::unique_ptr<Deduplicator> otherDedup;
+		if (plan.deduplicates()) {
+			dedup.reset(new Deduplicator);
+			if (reconcile) {
+				otherDedup.reset(new Deduplicator);
+			}
+		}
+		auto bind = [&plan, &dedup](const Row& headings) {
+			plan.bind(headings);
+			if (dedup) {
+				dedup->bind(plan.getDedupIndices());
+			}
+			return true;
+		};
+		auto bindOther = [&plan, &otherDedup](const Row& headings) {
+			plan.bindOther(headings);
+			if (otherDedup) {
+				otherDedup->bind(plan.getOtherDedupIndices());
+			}
+			return true;
+		};
 
-	void Processor::processExpenses(const Options& options)
-	{
-		Processor pr{options.getFilename(), options.getColumnSeparator()};
-		
-		if (options.code()) {
-			// change the default financial code heading:
-			pr.setDefaultFinCodeColumn(options.getFinCodeColumn());
+		// the rows are read, deduplicated and stored or aggregated
+		// by the reading steps:
+		std::unique_ptr<Processor> other;
+		std::unique_ptr<Processor> pr;
+		std::unique_ptr<Summary> summary;
+		if (reconcile) {
+			other.reset(new Processor{plan.getOtherFilename(), sep,
+									  plan.getOtherLoadColumns(), otherDedup.get(), bindOther});
 		}
-		
-		if (options.details()) {
-			// print the details for the columns ordered 
-			// by the given columns if not empty
-			pr.printDetailsForColumns(options.getDetailColumns(),
-			                         options.getOrderedByColumns());
+		if (plan.getStrategy() == Plan::Strategy::Streaming) {
+			summary.reset(new Summary{streamSummary(plan, dedup.get(), bind)});
+		} else {
+			pr.reset(new Processor{plan.getFilename(), sep, plan.getLoadColumns(),
+								   dedup.get(), bind});
 		}
-		
-		if (options.summary()) {
-			// print summary by code provided, group by 'Code' if
-			// the column exists, otherwise do nothing
-			pr.printSummaryForColumns(options.getSummaryColumns());
+
+		// then the steps on the rows read:
+		for(const auto& op : plan.getSteps()) {
+			switch(op.step) {
+			case Plan::Step::Sort:
+				pr->sortDB(plan.getOrderIndices());
+				break;
+			case Plan::Step::PrintDetails:
+				pr->printDetails(plan);
+				break;
+			case Plan::Step::Aggregate:
+				if (!summary) {
+					summary.reset(new Summary{pr->summarize(plan)});
+				}
+				break;
+			case Plan::Step::PrintSummary:
+				printSummary(*summary);
+				break;
+			case Plan::Step::Match:
+				pr->printReconciliation(*other, plan.makeReconciler());
+				break;
+			case Plan::Step::PrintDuplicates:
+				if (otherDedup) {
+					std::cout << "\nDuplicates removed from " << plan.getFilename() << ": "
+							  << dedup->getDuplicates() << "\n";
+					std::cout << "Duplicates removed from " << plan.getOtherFilename() << ": "
+							  << otherDedup->getDuplicates() << "\n";
+				} else {
+					std::cout << "\nDuplicates removed: " << dedup->getDuplicates() << "\n";
+				}
+				break;
+			default:
+				break; // done while reading
+			}
 		}
 	}
 	
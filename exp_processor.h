@@ -1,57 +1,97 @@
 #ifndef EXP_PROCESSOR_H_
 #define EXP_PROCESSOR_H_
 
+#include <functional>
+#include <memory_resource>
 #include <vector>
 
 #include "fmt.h"
+#include "row.h"
 
 namespace expenses {
 	class Options;
+	class Summary;
+	class Reconciler;
+	class Deduplicator;
+	class Plan;
 	class Processor {
-		using Row = std::vector<std::string>;
-		using DB = std::vector<Row>;
+		using DB = Table;
 		using IndexList = std::vector<int>;
 	public:
 		using DBRow = Row;
 
-		Processor(const std::string& filename, char fieldDelimiter);
+		// given the headings of the file, before any row is read;
+		// no row is read if it returns false
+		using HeadingsCheck = std::function<bool(const Row& headings)>;
+
+		// only the given columns are loaded if any are given,
+		// all of them otherwise; the rows dedup, bound to the
+		// headings by check, has seen are dropped. The file "-"
+		// is the standard input
+		Processor(const std::string& filename, char fieldDelimiter,
+				  const ColumnList& columns = ColumnList{},
+				  Deduplicator* dedup = nullptr,
+				  const HeadingsCheck& check = nullptr);
+
+		Processor(const Processor&) = delete;
+		Processor& operator=(const Processor&) = delete;
+
+		// the column the rows are grouped by unless --code is given
+		static const std::string defaultCodeColumn;
+
 		static void processExpenses(const Options& options);
 		void dump() const;
-		double getColumnTotal(const std::string& column,
-							  const std::string& code = "") const;
 		Row getHeadings() const { return db.empty() ? Row() : db[0]; }
 	
 		std::string getHeading(int i) const
-			{ return db.empty() ? "" : db[0].empty() ? "" : db[0][0]; }
+			{ return db.empty() ? "" : db[0].empty() ? "" : std::string{db[0][0]}; }
 	
-		Row getAllCodeValues() const { return getAllCodeValuesByIndex(0); }
-		Row getAllCodeValuesByIndex(int i) const;
-		Row getAllCodeValuesByColumn(const std::string& codeHeading) const;
+		ColumnList getAllCodeValues() const { return getAllCodeValuesByIndex(0); }
+		ColumnList getAllCodeValuesByIndex(int i) const;
 		void printCodes() const;
 
-		void printSummaryForColumns(const Row& columns,
-									const std::string& finCodeHeading="") const;
+		// aggregate the rows as the summary of plan does
+		Summary summarize(const Plan& plan) const;
 
-		void setDefaultFinCodeColumn(const std::string& column)
-		{ defaultFinCodeColumn = column; }
-	
-		IndexList getIndicesForColumns(const Row& columns) const;
-		void printDetailsForColumns(const Row& columns,
-									const Row& orderBy=Row{});
+		// match the rows against the ones of other and print the
+		// matched and unmatched ones
+		void printReconciliation(const Processor& other,
+								 const Reconciler& reconciler) const;
+
+		// print the detail columns of plan followed by its windows,
+		// if any, in the order of the rows
+		void printDetails(const Plan& plan) const;
 	private:
-		
-		Row fillRow(const std::string& line, char fieldDelimiter);
-		int findIndex(const std::string& column, bool ignoreCase = false) const;
-		void printLine(int len) const;
-		void sortDB(const Row& orderedBy);
+		using RowSink = std::function<void(const Row& row)>;
+
+		// pass every row of the file to addRow, the headings first;
+		// the row is only valid during the call
+		static void readRows(const std::string& filename, char fieldDelimiter,
+							 const ColumnList& columns, const RowSink& addRow,
+							 Deduplicator* dedup = nullptr,
+							 const HeadingsCheck& check = nullptr);
+		// aggregate the rows of the file of plan as they are read,
+		// without keeping them
+		static Summary streamSummary(const Plan& plan, Deduplicator* dedup,
+									 const HeadingsCheck& check);
+		static void printSummary(const Summary& summary);
+		static bool fillRow(const std::string& line, char fieldDelimiter,
+							const IndexList& fields, bool allFields, Row& row);
+		static IndexList resolveColumns(const Row& headings, const ColumnList& columns);
+		static Row store(const Row& row, std::pmr::memory_resource& arena);
+		static void printLine(int len);
+		void sortDB(const IndexList& orderedBy);
 		
 		static void reverse(Row& fields);
 		static bool isInteger(const std::string& str, int& nbr);
 		static bool isDate(const std::string& str, int& ival);
 		static std::string serializeRow(const Row& row, const IndexList& ordering);
 		
+		// the cells and rows are allocated from the arena, which
+		// releases them all at once; it must outlive db
+		std::pmr::monotonic_buffer_resource arena{1 << 20};
 		DB db;
-		std::string defaultFinCodeColumn{"Code"};
+		std::string filename;
 	};
 } // namespace expenses
  #endif
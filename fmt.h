@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <string_view>
 // #include <type_traits>
 
 
@@ -46,7 +47,7 @@ namespace expenses {
 			Format& hex() { fmt = std::ios_base::hex; return *this; }
 			Format& dec() { fmt = std::ios_base::dec; return *this; }
 			Format& boolAlpha() { fmt = std::ios_base::boolalpha; return *this;}
-			Format& fill(char ch) { fChar = ch; }
+			Format& fill(char ch) { fChar = ch; return *this; }
 			int getWidth() const { return width; }
 		private:
 			int prc;
@@ -72,9 +73,9 @@ namespace expenses {
 		{
 		Format(int w, std::ios_base::fmtflags f={}, char ch='*') :
 			width{w}, fmt{f}, fChar{ch} {}
-			Binder<std::string> operator()(const std::string& s)
+			Binder<std::string> operator()(std::string_view s)
 				{
-					return Binder<std::string>{*this, s};
+					return Binder<std::string>{*this, std::string{s}};
 				}
 			void fill(char ch) { fChar = ch; }
 			int getWidth() const { return width; }
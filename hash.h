@@ -0,0 +1,47 @@
+#ifndef HASH_H_
+#define HASH_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Fast non-cryptographic 64 bit hashing of keys and values; it
+// reads 8 bytes at a time and finishes with the splitmix64
+// mixer so that every bit of the result is usable
+namespace expenses {
+
+	inline uint64_t mix64(uint64_t x)
+	{
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9ULL;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111ebULL;
+		x ^= x >> 31;
+		return x;
+	}
+
+	inline uint64_t hashBytes(const char* data, size_t len, uint64_t seed = 0)
+	{
+		const uint64_t k = 0x9e3779b97f4a7c15ULL;
+		uint64_t h = seed ^ (len * k);
+		for(; len >= 8; data += 8, len -= 8) {
+			uint64_t word;
+			std::memcpy(&word, data, 8);
+			h = (h ^ mix64(word)) * k;
+		}
+
+		// the remaining bytes:
+		uint64_t tail = 0;
+		std::memcpy(&tail, data, len);
+		h = (h ^ mix64(tail)) * k;
+		return mix64(h);
+	}
+
+	inline uint64_t hashString(std::string_view s, uint64_t seed = 0)
+	{
+		return hashBytes(s.data(), s.size(), seed);
+	}
+
+} // namespace expenses
+
+#endif
@@ -0,0 +1,283 @@
+#include "input_reader.h"
+
+#include <cstring>
+#include <ios>
+#include <stdexcept>
+
+#include <zlib.h>
+#ifdef EXPENSES_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace expenses {
+
+	BlockQueue::Block* BlockQueue::acquire()
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		// wait for the consumer to hand a slot back:
+		while (t - head.load(std::memory_order_acquire) == Slots) {
+			if (cancelled.load(std::memory_order_acquire)) {
+				return nullptr;
+			}
+			std::this_thread::yield();
+		}
+
+		Block& block = blocks[t % Slots];
+		block.size = 0;
+		return &block;
+	}
+
+	void BlockQueue::publish()
+	{
+		tail.store(tail.load(std::memory_order_relaxed) + 1,
+				   std::memory_order_release);
+	}
+
+	void BlockQueue::close(std::exception_ptr err)
+	{
+		error = err;
+		closed.store(true, std::memory_order_release);
+	}
+
+	const BlockQueue::Block* BlockQueue::front()
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		while (h == tail.load(std::memory_order_acquire)) {
+			if (closed.load(std::memory_order_acquire)) {
+				// a block may have been published just before closing:
+				if (h != tail.load(std::memory_order_acquire)) {
+					break;
+				}
+				if (error) {
+					std::rethrow_exception(error);
+				}
+				return nullptr;
+			}
+			std::this_thread::yield();
+		}
+
+		return &blocks[h % Slots];
+	}
+
+	void BlockQueue::release()
+	{
+		head.store(head.load(std::memory_order_relaxed) + 1,
+				   std::memory_order_release);
+	}
+
+	InputReader::InputReader(const std::string& filename)
+	{
+		// "-" is the standard input, e.g. a pipe:
+		file = filename == "-" ? stdin : std::fopen(filename.c_str(), "rb");
+		if (!file) {
+			throw std::ios_base::failure{filename + " does not exist"};
+		}
+
+		// sniff the magic number to find out whether the
+		// file is compressed:
+		magicSize = std::fread(magic, 1, sizeof(magic), file);
+		const unsigned char* m = reinterpret_cast<const unsigned char*>(magic);
+		if (magicSize >= 2 && m[0] == 0x1f && m[1] == 0x8b) {
+			kind = Compression::Gzip;
+		} else if (magicSize == 4 && m[0] == 0x28 && m[1] == 0xb5 &&
+				   m[2] == 0x2f && m[3] == 0xfd) {
+			kind = Compression::Zstd;
+		}
+
+		if (kind == Compression::None) {
+			// the sniffed bytes are the start of the first line:
+			plain.reset(new char[BlockQueue::BlockSize]);
+			cur = magic;
+			end = magic + magicSize;
+			return;
+		}
+
+		worker = std::thread{&InputReader::decompress, this};
+	}
+
+	InputReader::~InputReader()
+	{
+		if (worker.joinable()) {
+			// the decompressor may be waiting for a free slot:
+			queue.cancel();
+			worker.join();
+		}
+		if (file != stdin) {
+			std::fclose(file);
+		}
+	}
+
+	bool InputReader::getline(std::string& line)
+	{
+		line.clear();
+		bool any = false;
+		for (;;) {
+			if (cur == end) {
+				if (!nextBlock()) {
+					return any;
+				}
+				continue;
+			}
+
+			auto nl = static_cast<const char*>(std::memchr(cur, '\n', end - cur));
+			if (nl) {
+				line.append(cur, nl);
+				cur = nl + 1;
+				return true;
+			}
+
+			// the line continues in the next block:
+			line.append(cur, end);
+			cur = end;
+			any = true;
+		}
+	}
+
+	bool InputReader::nextBlock()
+	{
+		if (kind == Compression::None) {
+			size_t n = std::fread(plain.get(), 1, BlockQueue::BlockSize, file);
+			cur = plain.get();
+			end = cur + n;
+			return n != 0;
+		}
+
+		if (holding) {
+			queue.release();
+			holding = false;
+		}
+
+		const BlockQueue::Block* block = queue.front();
+		if (!block) {
+			return false;
+		}
+
+		holding = true;
+		cur = block->data.get();
+		end = cur + block->size;
+		return true;
+	}
+
+	// runs on the worker thread
+	void InputReader::decompress()
+	{
+		try {
+			if (kind == Compression::Gzip) {
+				inflateGzip();
+			} else {
+				decompressZstd();
+			}
+		} catch(...) {
+			queue.close(std::current_exception());
+			return;
+		}
+		queue.close();
+	}
+
+	void InputReader::inflateGzip()
+	{
+		struct Stream : z_stream {
+			Stream() : z_stream{} {}
+			~Stream() { inflateEnd(this); }
+		} zs;
+
+		// 16 + MAX_WBITS: expect a gzip header and trailer
+		if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+			throw std::runtime_error{"cannot initialize zlib"};
+		}
+
+		std::unique_ptr<char[]> in{new char[BlockQueue::BlockSize]};
+		std::memcpy(in.get(), magic, magicSize);
+		zs.next_in = reinterpret_cast<Bytef*>(in.get());
+		zs.avail_in = magicSize;
+
+		BlockQueue::Block* block = queue.acquire();
+		bool memberEnd = false;
+		while (block) {
+			if (zs.avail_in == 0) {
+				zs.next_in = reinterpret_cast<Bytef*>(in.get());
+				zs.avail_in = std::fread(in.get(), 1, BlockQueue::BlockSize, file);
+				if (zs.avail_in == 0) {
+					if (!memberEnd) {
+						throw std::runtime_error{"truncated gzip input"};
+					}
+					break;
+				}
+			}
+
+			// concatenated gzip members are decompressed as one stream:
+			if (memberEnd) {
+				inflateReset(&zs);
+				memberEnd = false;
+			}
+
+			zs.next_out = reinterpret_cast<Bytef*>(block->data.get() + block->size);
+			zs.avail_out = BlockQueue::BlockSize - block->size;
+			int rc = inflate(&zs, Z_NO_FLUSH);
+			block->size = BlockQueue::BlockSize - zs.avail_out;
+			if (rc == Z_STREAM_END) {
+				memberEnd = true;
+			} else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+				throw std::runtime_error{std::string{"corrupt gzip input: "} +
+						(zs.msg ? zs.msg : "unknown error")};
+			}
+
+			if (block->size == BlockQueue::BlockSize) {
+				queue.publish();
+				block = queue.acquire();
+			}
+		}
+
+		if (block && block->size) {
+			queue.publish();
+		}
+	}
+
+	void InputReader::decompressZstd()
+	{
+#ifdef EXPENSES_HAVE_ZSTD
+		std::unique_ptr<ZSTD_DStream, size_t (*)(ZSTD_DStream*)>
+			ds{ZSTD_createDStream(), ZSTD_freeDStream};
+		ZSTD_initDStream(ds.get());
+
+		std::unique_ptr<char[]> in{new char[BlockQueue::BlockSize]};
+		std::memcpy(in.get(), magic, magicSize);
+		ZSTD_inBuffer input{in.get(), magicSize, 0};
+
+		BlockQueue::Block* block = queue.acquire();
+		size_t pending = 1; // 0 once a frame is complete
+		while (block) {
+			if (input.pos == input.size) {
+				input.size = std::fread(in.get(), 1, BlockQueue::BlockSize, file);
+				input.pos = 0;
+				if (input.size == 0) {
+					if (pending) {
+						throw std::runtime_error{"truncated zstd input"};
+					}
+					break;
+				}
+			}
+
+			ZSTD_outBuffer output{block->data.get(), BlockQueue::BlockSize, block->size};
+			pending = ZSTD_decompressStream(ds.get(), &output, &input);
+			if (ZSTD_isError(pending)) {
+				throw std::runtime_error{std::string{"corrupt zstd input: "} +
+						ZSTD_getErrorName(pending)};
+			}
+			block->size = output.pos;
+
+			if (block->size == BlockQueue::BlockSize) {
+				queue.publish();
+				block = queue.acquire();
+			}
+		}
+
+		if (block && block->size) {
+			queue.publish();
+		}
+#else
+		throw std::runtime_error{"zstd input is not supported by this build"};
+#endif
+	}
+
+} // namespace expenses
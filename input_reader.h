@@ -0,0 +1,97 @@
+#ifndef INPUT_READER_H_
+#define INPUT_READER_H_
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Line oriented reader for the expenses input, a file or "-"
+// for the standard input, read in large blocks; gzip and zstd
+// compressed input is detected by its magic number and
+// decompressed on a dedicated thread
+namespace expenses {
+
+	// bounded single producer/single consumer queue of fixed size
+	// buffers; the producer fills the slot at the tail in place
+	// and the consumer hands the slot at the head back once it is
+	// done with it, so no buffer is ever allocated after start-up
+	class BlockQueue
+	{
+	public:
+		static constexpr size_t BlockSize = 256 * 1024;
+		static constexpr size_t Slots = 8;
+
+		struct Block
+		{
+			std::unique_ptr<char[]> data{new char[BlockSize]};
+			size_t size{0};
+		};
+
+		// producer side: acquire returns nullptr once the
+		// consumer has gone away
+		Block* acquire();
+		void publish();
+		void close(std::exception_ptr error = nullptr);
+
+		// consumer side: front returns nullptr once the queue
+		// is closed and drained
+		const Block* front();
+		void release();
+		void cancel() { cancelled.store(true, std::memory_order_release); }
+
+	private:
+		std::array<Block, Slots> blocks;
+		std::atomic<size_t> head{0};
+		std::atomic<size_t> tail{0};
+		std::atomic<bool> closed{false};
+		std::atomic<bool> cancelled{false};
+		std::exception_ptr error;
+	};
+
+	class InputReader
+	{
+	public:
+		enum class Compression { None, Gzip, Zstd };
+
+		explicit InputReader(const std::string& filename);
+		~InputReader();
+
+		InputReader(const InputReader&) = delete;
+		InputReader& operator=(const InputReader&) = delete;
+
+		// read the next line without its terminator; false at
+		// the end of input
+		bool getline(std::string& line);
+
+	private:
+		bool nextBlock();
+		void decompress();
+		void inflateGzip();
+		void decompressZstd();
+
+		std::FILE* file{nullptr};
+		Compression kind{Compression::None};
+
+		// bytes already read while sniffing the magic number:
+		char magic[4];
+		size_t magicSize{0};
+
+		// the block currently being split into lines:
+		const char* cur{nullptr};
+		const char* end{nullptr};
+		bool holding{false};
+
+		// used for uncompressed input only:
+		std::unique_ptr<char[]> plain;
+
+		BlockQueue queue;
+		std::thread worker;
+	};
+
+} // namespace expenses
+
+#endif
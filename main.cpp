@@ -1,3 +1,6 @@
+#include <iostream>
+#include <stdexcept>
+
 #include "options.h"
 #include "exp_processor.h"
 
@@ -13,7 +16,13 @@ int main(int argc, const char* argv[]) {
 	Options options(argc, argv);
 	//	options.print();
 	
-	Processor::processExpenses(options);
+	try {
+		Processor::processExpenses(options);
+	} catch(const std::exception& e) {
+		// e.g. an unknown column, reported before the rows are read
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
 
 	return 0;
 }
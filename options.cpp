@@ -1,13 +1,16 @@
 #include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <thread>
 
 #include "options.h"
 
 namespace expenses {
 	
 	const std::vector<std::string> Options::optLabels
-	{"detail", "summary", "sep", "orderedby", "code"};
+	{"detail", "summary", "sep", "orderedby", "code", "window",
+	 "reconcile", "matchon", "matchdate", "tolerance", "dedup",
+	 "threads", "exact", "explain"};
 
 	Options::Options(int argc, const char* argv[])
 	{
@@ -22,6 +25,10 @@ namespace expenses {
 		
 			// which one is it?
 			int index = it - optLabels.begin();
+			if (isFlag(index)) {
+				options.set(index, 1);
+				return;
+			}
 		
 			// process the value before turning the option on:
 			ColumnList elements = parseValue(value);
@@ -68,6 +75,12 @@ namespace expenses {
 
 			switch(*ch) {
 			case '-': { // found an option;
+				// a lone '-' is the standard input:
+				if (!ch[1] || isspace(ch[1])) {
+					filename = readString(ch);
+					break;
+				}
+
 				if (*++ch != '-') {
 					throw std::runtime_error{"Invalid option"};
 				}
@@ -76,6 +89,11 @@ namespace expenses {
 				while(*++ch && !isspace(*ch) && !ispunct(*ch)) {
 					key += *ch;
 				}
+
+				// a flag has no value:
+				if (*ch != '=') {
+					processOption(key, "");
+				}
 				break;
 			}
 			case '=': { // found a value:
@@ -97,14 +115,56 @@ namespace expenses {
 
 	Options::ColumnList Options::parseValue(const std::string& value)
 	{
-		std::istringstream is{value};
-		std::string member;
+		// commas inside parentheses, as in f(a,b), do not
+		// separate members:
 		ColumnList members;
-		while(std::getline(is, member, ','))
+		std::string member;
+		int depth = 0;
+		for(char ch : value) {
+			if (ch == ',' && depth == 0) {
+				members.push_back(member);
+				member.clear();
+				continue;
+			}
+			depth += ch == '(' ? 1 : ch == ')' ? -1 : 0;
+			member += ch;
+		}
+		if (!member.empty())
 			members.push_back(member);
 		return members;
 	}
 
+	int Options::getTolerance() const
+	{
+		if (!options[ToleranceOn]) {
+			return 0;
+		}
+
+		try {
+			return std::stoi(optValues[ToleranceOn][0]);
+		} catch(const std::exception& e) {
+			throw std::runtime_error{"Invalid tolerance: " + optValues[ToleranceOn][0]};
+		}
+	}
+
+	unsigned Options::getThreads() const
+	{
+		if (!options[ThreadsOn]) {
+			return std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		try {
+			int n = std::stoi(optValues[ThreadsOn][0]);
+			if (n < 1) {
+				throw std::out_of_range{optValues[ThreadsOn][0]};
+			}
+			return n;
+		} catch(const std::exception& e) {
+			throw std::runtime_error{"Invalid number of threads: " +
+					optValues[ThreadsOn][0]};
+		}
+	}
+
 	void Options::print() const
 	{
 		for(int i=0; i < OptionEnd; ++i) {
@@ -144,11 +204,66 @@ namespace expenses {
 			"\tcolumns should be given here. The transactions are grouped\n"
 			"\tthe value of code, see below for more on code.\n";
 
+		std::cout << "\tA column can also be given as function(column) where\n"
+			"\tthe function is one of sum, count, avg, min, max, median,\n"
+			"\tpNN (the NNth percentile, e.g. p95), distinct (the\n"
+			"\tnumber of distinct values) or cells (the number of values\n"
+			"\tthat are not empty). The others, count included, only use\n"
+			"\tthe values that are numbers. Percentiles and distinct\n"
+			"\tcounts are estimated in constant memory on large inputs.\n";
+
+		std::cout << "--exact\n"
+			"\tCompute percentiles and distinct counts exactly; this\n"
+			"\tkeeps all the values in memory.\n";
+
 		std::cout << "--code=column_for_code\n"
 			"\tTransactions are summarized by financial codes\n"
 			"\tif this value is set, transactions will be grouped by\n"
 			"\tthis code; otherwise, the default value is 'Code'.\n";
 
+		std::cout << "--window=function_1(column)[, ..., function_n(column, N)]\n"
+			"\tThis is only used for a detailed transaction printing.\n"
+			"\tAdd a column per window function, computed per code over\n"
+			"\tthe ordered transactions: cumsum(column) is the running\n"
+			"\tsum, msum(column, N) and mavg(column, N) the sum and average\n"
+			"\tover the last N transactions or, with N given as e.g. 30d,\n"
+			"\tthe last N days of the first column ordered by; another\n"
+			"\tcolumn ordered by can hold the dates, e.g. msum(Amount, 30d,\n"
+			"\tDate).\n";
+
+		std::cout << "--reconcile=other_file --matchon=column_1[, ..., column_n]\n"
+			"\t[--matchdate=date_column --tolerance=days]\n"
+			"\tMatch the transactions of the file against the ones of\n"
+			"\tother_file and print the matched and unmatched ones.\n"
+			"\tTransactions match when the matchon columns are equal\n"
+			"\t(by value for a column of decimals such as an amount)\n"
+			"\tand their dates at most tolerance days\n"
+			"\tapart (0 by default). A column named differently in\n"
+			"\tother_file is given as column:other_column. The --detail\n"
+			"\tcolumns of either file are printed with the transactions;\n"
+			"\t--summary, --window and --orderedby cannot be combined\n"
+			"\twith --reconcile.\n";
+
+		std::cout << "--dedup=column_1[, column_2, ..., column_n]\n"
+			"\tDrop the transactions whose values in the given columns\n"
+			"\trepeat those of an earlier transaction, e.g. the ones\n"
+			"\tshared by overlapping exports, and print how many were\n"
+			"\tdropped. With --reconcile both files are deduplicated; a\n"
+			"\tcolumn named differently in other_file is given as\n"
+			"\tcolumn:other_column.\n";
+
+		std::cout << "--threads=N\n"
+			"\tCompute the summary with N threads; by default one per\n"
+			"\tcore. The results do not depend on the number of threads.\n";
+
+		std::cout << "--explain\n"
+			"\tPrint how the options would be carried out: the columns\n"
+			"\tused, where they are in the file and the steps, without\n"
+			"\treading more than the headings.\n";
+
+		std::cout << "The file can be - to read the standard input, e.g. from\n"
+			"a pipe; it can be compressed with gzip or zstd.\n\n";
+
 		std::cout << "Here is an example:\n\n"
 			"./ex --detail=FinCode,Date,Amount,HST13%,HST5%/TVQ,Total --orderedBy=Date,Entry# --summary=Amount,HST13%,HST5%/TVQ,Total --code=FinCode --sep='|' ~/expenses.csv\n";
 
@@ -14,6 +14,16 @@ namespace expenses {
 			SeparatorOn,
 			OrderedByOn,
 			CodeOn,
+			WindowOn,
+			ReconcileOn,
+			MatchKeysOn,
+			MatchDateOn,
+			ToleranceOn,
+			DedupOn,
+			ThreadsOn,
+			// flags, they take no value:
+			ExactOn,
+			ExplainOn,
 			OptionEnd
 		};
 	public:
@@ -26,6 +36,11 @@ namespace expenses {
 		bool separator() const { return options[SeparatorOn]; }
 		bool orderedBy() const { return options[OrderedByOn]; }
 		bool code() const { return options[CodeOn]; }
+		bool window() const { return options[WindowOn]; }
+		bool reconcile() const { return options[ReconcileOn]; }
+		bool dedup() const { return options[DedupOn]; }
+		bool exact() const { return options[ExactOn]; }
+		bool explain() const { return options[ExplainOn]; }
 
 		char getColumnSeparator() const {
 			return separator() ? optValues[SeparatorOn][0][0] : ',';
@@ -44,6 +59,28 @@ namespace expenses {
 
 		const ColumnList& getDetailColumns() const
 		{ return optValues[DetailOn]; }
+
+		const ColumnList& getWindowColumns() const
+		{ return optValues[WindowOn]; }
+
+		std::string getReconcileFilename() const
+			{ return reconcile() ? optValues[ReconcileOn][0] : ""; }
+
+		const ColumnList& getMatchColumns() const
+		{ return optValues[MatchKeysOn]; }
+
+		std::string getMatchDateColumn() const
+			{ return options[MatchDateOn] ? optValues[MatchDateOn][0] : ""; }
+
+		const ColumnList& getDedupColumns() const
+		{ return optValues[DedupOn]; }
+
+		// the number of threads to use, by default one per core
+		unsigned getThreads() const;
+
+		// days two matching dates can be apart, 0 by default
+		int getTolerance() const;
+
 	
 		void printSetOptions();
 		static void printSupportedOptions();
@@ -52,6 +89,7 @@ namespace expenses {
 		void processOption(const std::string& key,
 						   const std::string& value);
 		ColumnList parseValue(const std::string& value);
+		static bool isFlag(int index) { return index >= ExactOn; }
 
 		std::bitset<OptionEnd> options;
 		std::string filename;
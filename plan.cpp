@@ -0,0 +1,394 @@
+#include "plan.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+#include "exp_processor.h"
+#include "options.h"
+
+namespace expenses {
+
+	namespace {
+		std::string join(const ColumnList& values)
+		{
+			std::string text;
+			for(const auto& value : values) {
+				text += (text.empty() ? "" : ", ") + value;
+			}
+			return text;
+		}
+	}
+
+	Plan::Plan(const Options& options) :
+		filename{options.getFilename()},
+		separator{options.getColumnSeparator()},
+		dedup{options.dedup()},
+		codeColumn{options.code() ? options.getFinCodeColumn() :
+				   Processor::defaultCodeColumn},
+		exact{options.exact()},
+		threads{options.getThreads()}
+	{
+		// when reconciling, both files are deduplicated, a column
+		// named differently in the other file given as ours:theirs
+		ColumnList dedupColumns;
+		ColumnList otherDedupColumns;
+		for(const auto& column : options.getDedupColumns()) {
+			if (options.reconcile()) {
+				auto names = Reconciler::split(column);
+				dedupColumns.push_back(names.first);
+				otherDedupColumns.push_back(names.second);
+			} else {
+				dedupColumns.push_back(column);
+			}
+		}
+
+		if (options.reconcile()) {
+			// only the transactions themselves are printed:
+			if (options.summary() || options.window() || options.orderedBy()) {
+				throw std::runtime_error{"--summary, --window and --orderedby cannot "
+						"be combined with --reconcile"};
+			}
+
+			strategy = Strategy::Reconcile;
+			otherFilename = options.getReconcileFilename();
+			matchColumns = options.getMatchColumns();
+			matchDateColumn = options.getMatchDateColumn();
+			tolerance = options.getTolerance();
+			Reconciler reconciler{matchColumns, matchDateColumn, tolerance};
+
+			// the date, if any, is the last column matched on:
+			bool hasDate = !matchDateColumn.empty();
+			auto useMatched = [hasDate, this](std::vector<Column>& list,
+											  const ColumnList& matched,
+											  std::vector<int>& keyIds, int& dateId) {
+				for(size_t i = 0; i < matched.size(); ++i) {
+					if (hasDate && i + 1 == matched.size()) {
+						dateId = use(list, matched[i], Type::Date, "match date");
+					} else {
+						keyIds.push_back(use(list, matched[i], Type::Text, "match"));
+					}
+				}
+			};
+			useMatched(columns, reconciler.getLeftColumns(), matchIds, matchDateId);
+			useMatched(otherColumns, reconciler.getRightColumns(), otherMatchIds,
+					   otherMatchDateId);
+
+			// the details are printed from the files that have them:
+			const ColumnList& details = options.getDetailColumns();
+			for(const auto& column : details) {
+				use(columns, column, Type::Text, "detail", false);
+				use(otherColumns, column, Type::Text, "detail", false);
+			}
+
+			for(const auto& column : dedupColumns) {
+				dedupIds.push_back(use(columns, column, Type::Text, "dedup"));
+			}
+			for(const auto& column : otherDedupColumns) {
+				otherDedupIds.push_back(use(otherColumns, column, Type::Text, "dedup"));
+			}
+			for(const auto& column : otherColumns) {
+				otherLoad.push_back(column.name);
+			}
+
+			// the other file is read first:
+			steps.push_back({Step::Read, "read " + otherFilename + ": " + join(otherLoad)});
+			if (dedup) {
+				steps.push_back({Step::Dedup, "drop the rows repeated on " +
+							join(otherDedupColumns)});
+			}
+		} else {
+			const ColumnList& orderedBy = options.getOrderedByColumns();
+			if (options.summary() && !options.details()) {
+				strategy = Strategy::Streaming;
+			} else if (options.details() && !orderedBy.empty()) {
+				strategy = Strategy::Sorted;
+			}
+
+			if (options.details()) {
+				for(const auto& column : options.getDetailColumns()) {
+					detailIds.push_back(use(columns, column, Type::Text, "detail"));
+				}
+				if (strategy == Strategy::Sorted) {
+					for(const auto& column : orderedBy) {
+						orderIds.push_back(use(columns, column, Type::Text, "order"));
+					}
+				}
+
+				// the windows are computed per code, if there is
+				// a code column, in the order of the rows; windows
+				// in days use the column of dates they name or else
+				// the first column ordered by:
+				for(const auto& column : options.getWindowColumns()) {
+					windowSpecs.push_back(WindowSpec::parse(column));
+					WindowSpec& spec = windowSpecs.back();
+					if (spec.days && spec.date.empty() && !orderedBy.empty()) {
+						spec.date = orderedBy[0];
+					}
+					if (spec.days && std::find(orderedBy.begin(), orderedBy.end(),
+											   spec.date) == orderedBy.end()) {
+						throw std::runtime_error{"A window in days needs the rows "
+								"ordered by its dates: " + column};
+					}
+					windowIds.push_back(use(columns, spec.column, Type::Number, "window"));
+					windowDateIds.push_back(spec.days ?
+							use(columns, spec.date, Type::Date, "window days") : -1);
+				}
+				if (!windowSpecs.empty()) {
+					partitionId = use(columns, codeColumn, Type::Text, "partition", false);
+				}
+			}
+
+			if (options.summary()) {
+				for(const auto& column : options.getSummaryColumns()) {
+					summarySpecs.push_back(AggregateSpec::parse(column));
+					const AggregateSpec& spec = summarySpecs.back();
+					summaryIds.push_back(use(columns, spec.column, spec.isText() ?
+											 Type::Text : Type::Number, "summary"));
+				}
+				codeId = use(columns, codeColumn, Type::Text, "group");
+			}
+
+			for(const auto& column : dedupColumns) {
+				dedupIds.push_back(use(columns, column, Type::Text, "dedup"));
+			}
+		}
+
+		// only the columns of the plan are loaded:
+		for(const auto& column : columns) {
+			load.push_back(column.name);
+		}
+
+		steps.push_back({Step::Read, "read " + filename + ": " + join(load)});
+		if (dedup) {
+			steps.push_back({Step::Dedup, "drop the rows repeated on " + join(dedupColumns)});
+		}
+		if (strategy != Strategy::Streaming) {
+			steps.push_back({Step::Store, "store the rows in memory"});
+		}
+		if (strategy == Strategy::Sorted) {
+			steps.push_back({Step::Sort, "sort by " + join(options.getOrderedByColumns())});
+		}
+		if (strategy == Strategy::Reconcile) {
+			bool hasDate = !matchDateColumn.empty();
+			steps.push_back({Step::Match, "hash join on " + join(matchColumns) +
+						(hasDate ? (matchColumns.empty() ? "" : " and ") + matchDateColumn +
+						 " within " + std::to_string(tolerance) + " days" : "") +
+						", print the matched and unmatched rows"});
+		} else if (options.details()) {
+			ColumnList labels;
+			for(const auto& spec : windowSpecs) {
+				labels.push_back(spec.label);
+			}
+			steps.push_back({Step::PrintDetails, "print the details: " +
+						join(options.getDetailColumns()) +
+						(labels.empty() ? "" : " with the windows per " + codeColumn + ": " +
+						 join(labels))});
+		}
+		if (options.summary() && strategy != Strategy::Reconcile) {
+			ColumnList labels;
+			for(const auto& spec : summarySpecs) {
+				labels.push_back(spec.label);
+			}
+			steps.push_back({Step::Aggregate, "aggregate by " + codeColumn + " in chunks of " +
+						std::to_string(Summary::chunkSize) + " rows on " +
+						std::to_string(threads) + (threads > 1 ? " threads: " : " thread: ") +
+						join(labels)});
+			steps.push_back({Step::PrintSummary, "print the summary"});
+		}
+		if (dedup) {
+			steps.push_back({Step::PrintDuplicates, "print the number of duplicates"});
+		}
+	}
+
+	// a column used several times has all its uses; it is a
+	// number or a date if any use needs it to be one. Its position
+	// in list is returned
+	int Plan::use(std::vector<Column>& list, const std::string& name, Type type,
+				  const std::string& what, bool required)
+	{
+		auto it = std::find_if(list.begin(), list.end(),
+							   [&name](const Column& column) { return column.name == name; });
+		if (it == list.end()) {
+			list.push_back(Column{name, type, what, required});
+			return list.size() - 1;
+		}
+
+		if (it->uses.find(what) == std::string::npos) {
+			it->uses += ", " + what;
+		}
+		it->type = std::max(it->type, type);
+		it->required = it->required || required;
+		return it - list.begin();
+	}
+
+	void Plan::bind(const Row& headings)
+	{
+		resolve(columns, load, headings, filename);
+		this->headings = headings.size();
+		checkDetails();
+	}
+
+	void Plan::bindOther(const Row& headings)
+	{
+		resolve(otherColumns, otherLoad, headings, otherFilename);
+		otherHeadings = headings.size();
+		checkDetails();
+	}
+
+	// when reconciling, a detail column must be in at least one
+	// of the files; checked once both are bound, in either order
+	void Plan::checkDetails() const
+	{
+		if (strategy != Strategy::Reconcile || headings < 0 || otherHeadings < 0) {
+			return;
+		}
+		for(const auto& column : columns) {
+			if (column.required || column.position >= 0) {
+				continue;
+			}
+			auto other = std::find_if(otherColumns.begin(), otherColumns.end(),
+									  [&column](const Column& c) { return c.name == column.name; });
+			if (other == otherColumns.end() || other->position < 0) {
+				throw std::runtime_error{"Unknown column " + column.name + " in " +
+						filename + " and " + otherFilename};
+			}
+		}
+	}
+
+	void Plan::resolve(std::vector<Column>& list, const ColumnList& loaded,
+					   const Row& headings, const std::string& filename)
+	{
+		// the rows keep the loaded columns in the order of the file:
+		std::vector<int> kept;
+		for(int i = 0, e = headings.size(); i != e; ++i) {
+			if (loaded.empty() ||
+				std::find(loaded.begin(), loaded.end(), headings[i]) != loaded.end()) {
+				kept.push_back(i);
+			}
+		}
+
+		for(auto& column : list) {
+			auto it = std::find(headings.begin(), headings.end(), column.name);
+			if (it == headings.end()) {
+				if (column.required) {
+					throw std::runtime_error{"Unknown column " + column.name +
+							" in " + filename};
+				}
+				continue;
+			}
+
+			// every column of the plan must be loaded:
+			column.position = it - headings.begin();
+			auto loadedAt = std::lower_bound(kept.begin(), kept.end(), column.position);
+			if (loadedAt == kept.end() || *loadedAt != column.position) {
+				throw std::logic_error{"Column " + column.name + " of " + filename +
+						" is not loaded"};
+			}
+			column.index = loadedAt - kept.begin();
+		}
+	}
+
+	std::vector<int> Plan::indicesOf(const std::vector<Column>& list,
+									 const std::vector<int>& ids, int headings)
+	{
+		if (headings < 0) {
+			throw std::logic_error{"The plan is not bound to the headings"};
+		}
+
+		std::vector<int> indices;
+		for(int id : ids) {
+			indices.push_back(id >= 0 ? list[id].index : -1);
+		}
+		return indices;
+	}
+
+	std::vector<int> Plan::getDedupIndices() const
+	{
+		return indicesOf(columns, dedupIds, headings);
+	}
+
+	std::vector<int> Plan::getOtherDedupIndices() const
+	{
+		return indicesOf(otherColumns, otherDedupIds, otherHeadings);
+	}
+
+	std::vector<int> Plan::getDetailIndices() const
+	{
+		return indicesOf(columns, detailIds, headings);
+	}
+
+	std::vector<int> Plan::getOrderIndices() const
+	{
+		return indicesOf(columns, orderIds, headings);
+	}
+
+	Window Plan::makeWindow() const
+	{
+		Window window{windowSpecs};
+		window.bind(indicesOf(columns, {partitionId}, headings)[0],
+					indicesOf(columns, windowDateIds, headings),
+					indicesOf(columns, windowIds, headings));
+		return window;
+	}
+
+	Summary Plan::makeSummary() const
+	{
+		Summary summary{summarySpecs, codeColumn, exact};
+		summary.bind(indicesOf(columns, {codeId}, headings)[0],
+					 indicesOf(columns, summaryIds, headings));
+		return summary;
+	}
+
+	Reconciler Plan::makeReconciler() const
+	{
+		Reconciler reconciler{matchColumns, matchDateColumn, tolerance};
+		reconciler.bind(indicesOf(columns, matchIds, headings),
+						indicesOf(columns, {matchDateId}, headings)[0],
+						indicesOf(otherColumns, otherMatchIds, otherHeadings),
+						indicesOf(otherColumns, {otherMatchDateId}, otherHeadings)[0]);
+		return reconciler;
+	}
+
+	void Plan::explain(std::ostream& os) const
+	{
+		static const char* strategies[] = {"streaming", "in memory", "sorted in memory",
+										   "reconcile in memory"};
+		os << "Plan: " << strategies[static_cast<int>(strategy)] << "\n";
+		explainColumns(os, filename, columns, headings);
+		if (strategy == Strategy::Reconcile) {
+			explainColumns(os, otherFilename, otherColumns, otherHeadings);
+		}
+
+		os << "Steps:\n";
+		for(size_t i = 0; i < steps.size(); ++i) {
+			os << "  " << i + 1 << ". " << steps[i].description << "\n";
+		}
+	}
+
+	void Plan::explainColumns(std::ostream& os, const std::string& filename,
+							  const std::vector<Column>& list, int headings)
+	{
+		static const char* types[] = {"text", "number", "date"};
+		os << "Columns of " << filename;
+		if (headings >= 0) {
+			os << " (" << headings << " in the file)";
+		}
+		os << ":\n";
+
+		for(const auto& column : list) {
+			os << "  " << std::left << std::setw(16) << column.name
+			   << std::setw(8) << types[static_cast<int>(column.type)];
+			if (column.position >= 0) {
+				os << "field " << std::setw(4) << column.position
+				   << "index " << std::setw(4) << column.index;
+			} else {
+				os << std::setw(20) << "not in the file";
+			}
+			os << column.uses << "\n";
+		}
+		os << std::right;
+	}
+
+} // namespace expenses
@@ -0,0 +1,144 @@
+#ifndef PLAN_H_
+#define PLAN_H_
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "reconcile.h"
+#include "row.h"
+#include "summary.h"
+#include "window.h"
+
+// The options compiled once into what a run does: how the rows
+// are processed, the columns each step uses and where they are
+// in the file. The options are checked when the plan is made and
+// the columns as soon as the headings are read, before any row;
+// the operators are then given the positions of their columns
+namespace expenses {
+	class Options;
+	class Plan
+	{
+	public:
+		enum class Strategy {
+			Streaming,	// the rows are aggregated as they are read
+			InMemory,	// the rows are loaded, in the order of the file
+			Sorted,		// the rows are loaded then sorted
+			Reconcile	// both files are loaded then matched
+		};
+
+		enum class Type { Text, Number, Date };
+
+		// the rows are read, deduplicated and stored or aggregated
+		// as they are read; the other steps run once they all are
+		enum class Step {
+			Read, Dedup, Store, Sort, PrintDetails, Aggregate, PrintSummary,
+			Match, PrintDuplicates
+		};
+
+		struct Operator
+		{
+			Step step;
+			std::string description;
+		};
+
+		// a column used by the plan
+		struct Column
+		{
+			std::string name;
+			Type type{Type::Text};
+			std::string uses;	// what it is used for, e.g. "detail, order"
+			bool required{true};
+			int position{-1};	// in the file
+			int index{-1};		// in the rows as loaded
+		};
+
+		// throws if the options are inconsistent or use an
+		// unknown function
+		explicit Plan(const Options& options);
+
+		Strategy getStrategy() const { return strategy; }
+		const std::vector<Operator>& getSteps() const { return steps; }
+
+		// what to read from the file and, when reconciling, from
+		// the other file
+		const std::string& getFilename() const { return filename; }
+		const std::string& getOtherFilename() const { return otherFilename; }
+		char getSeparator() const { return separator; }
+		const ColumnList& getLoadColumns() const { return load; }
+		const ColumnList& getOtherLoadColumns() const { return otherLoad; }
+
+		// resolve the columns against the headings of the file, or
+		// of the other file, in either order; throws if a required
+		// one is missing
+		void bind(const Row& headings);
+		void bindOther(const Row& headings);
+
+		// the operators, their columns given by their positions in
+		// the rows as loaded; the plan must be bound
+		bool deduplicates() const { return dedup; }
+		std::vector<int> getDedupIndices() const;
+		std::vector<int> getOtherDedupIndices() const;
+		std::vector<int> getDetailIndices() const;
+		std::vector<int> getOrderIndices() const;
+		Window makeWindow() const;
+		Summary makeSummary() const;
+		Reconciler makeReconciler() const;
+		unsigned getThreads() const { return threads; }
+
+		void explain(std::ostream& os) const;
+
+	private:
+		int use(std::vector<Column>& list, const std::string& name, Type type,
+				const std::string& what, bool required = true);
+		void checkDetails() const;
+		static void resolve(std::vector<Column>& list, const ColumnList& loaded,
+							const Row& headings, const std::string& filename);
+		static std::vector<int> indicesOf(const std::vector<Column>& list,
+										  const std::vector<int>& ids, int headings);
+		static void explainColumns(std::ostream& os, const std::string& filename,
+								   const std::vector<Column>& list, int headings);
+
+		Strategy strategy{Strategy::InMemory};
+		std::string filename;
+		std::string otherFilename;
+		char separator;
+		ColumnList load;
+		ColumnList otherLoad;
+		std::vector<Column> columns;
+		std::vector<Column> otherColumns;
+		int headings{-1};
+		int otherHeadings{-1};
+		std::vector<Operator> steps;
+
+		// the columns of the operators, as positions in columns,
+		// or otherColumns for the other file; -1 for none
+		bool dedup{false};
+		std::vector<int> dedupIds;
+		std::vector<int> otherDedupIds;
+		std::vector<int> detailIds;
+		std::vector<int> orderIds;
+
+		std::vector<WindowSpec> windowSpecs;
+		std::vector<int> windowIds;
+		std::vector<int> windowDateIds;
+		int partitionId{-1};
+
+		std::vector<AggregateSpec> summarySpecs;
+		std::vector<int> summaryIds;
+		std::string codeColumn;
+		int codeId{-1};
+		bool exact{false};
+		unsigned threads{1};
+
+		ColumnList matchColumns;
+		std::string matchDateColumn;
+		int tolerance{0};
+		std::vector<int> matchIds;
+		std::vector<int> otherMatchIds;
+		int matchDateId{-1};
+		int otherMatchDateId{-1};
+	};
+} // namespace expenses
+
+#endif
@@ -0,0 +1,275 @@
+#include "reconcile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "window.h"
+
+namespace expenses {
+
+	Reconciler::Reconciler(const ColumnList& keyColumns, const std::string& dateColumn,
+						   int tolerance) :
+		tolerance{tolerance}
+	{
+		if (keyColumns.empty() && dateColumn.empty()) {
+			throw std::runtime_error{"Nothing to match the rows on"};
+		}
+		if (tolerance < 0) {
+			throw std::runtime_error{"The date tolerance cannot be negative"};
+		}
+
+		for(const auto& column : keyColumns) {
+			auto names = split(column);
+			leftKeys.push_back(names.first);
+			rightKeys.push_back(names.second);
+		}
+
+		if (!dateColumn.empty()) {
+			auto names = split(dateColumn);
+			leftDate = names.first;
+			rightDate = names.second;
+		}
+	}
+
+	std::pair<std::string, std::string> Reconciler::split(const std::string& column)
+	{
+		size_t colon = column.find(':');
+		if (colon == std::string::npos) {
+			return {column, column};
+		}
+		return {column.substr(0, colon), column.substr(colon + 1)};
+	}
+
+	ColumnList Reconciler::getLeftColumns() const
+	{
+		ColumnList columns = leftKeys;
+		if (!leftDate.empty()) {
+			columns.push_back(leftDate);
+		}
+		return columns;
+	}
+
+	ColumnList Reconciler::getRightColumns() const
+	{
+		ColumnList columns = rightKeys;
+		if (!rightDate.empty()) {
+			columns.push_back(rightDate);
+		}
+		return columns;
+	}
+
+	void Reconciler::bind(const std::vector<int>& leftKeyIndices, int leftDateIndex,
+						  const std::vector<int>& rightKeyIndices, int rightDateIndex)
+	{
+		leftIndices = Keys{leftKeyIndices, leftDateIndex};
+		rightIndices = Keys{rightKeyIndices, rightDateIndex};
+	}
+
+	// a plain decimal such as -12.50: no exponent, no hexadecimal
+	// and no leading zero, which would make 00123 a number
+	bool Reconciler::isDecimal(Cell value)
+	{
+		size_t i = !value.empty() && (value[0] == '-' || value[0] == '+');
+		size_t digits = 0;
+		for(; i < value.size() && std::isdigit(static_cast<unsigned char>(value[i])); ++i) {
+			++digits;
+		}
+		if (digits == 0 || (digits > 1 && value[i - digits] == '0')) {
+			return false;
+		}
+		if (i < value.size() && value[i] == '.') {
+			size_t decimals = 0;
+			for(++i; i < value.size() && std::isdigit(static_cast<unsigned char>(value[i])); ++i) {
+				++decimals;
+			}
+			if (decimals == 0) {
+				return false;
+			}
+		}
+		return i == value.size();
+	}
+
+	// a key column is compared by value, e.g. an amount, if all
+	// its values in both tables are decimals; byte for byte otherwise
+	std::vector<bool> Reconciler::numericKeys(const Table& left, const Keys& lKeys,
+											  const Table& right, const Keys& rKeys)
+	{
+		auto allDecimal = [](const Table& table, int index) {
+			for(int r = 1, e = table.size(); r < e; ++r) {
+				const Row& row = table[r];
+				if (index < static_cast<int>(row.size()) && !row[index].empty() &&
+					!isDecimal(row[index])) {
+					return false;
+				}
+			}
+			return true;
+		};
+
+		std::vector<bool> numeric;
+		for(size_t i = 0; i < lKeys.indices.size(); ++i) {
+			numeric.push_back(allDecimal(left, lKeys.indices[i]) &&
+							  allDecimal(right, rKeys.indices[i]));
+		}
+		return numeric;
+	}
+
+	// the exact match key of a row; numeric columns are compared
+	// by value, to the cent, so that 12.5 matches 12.50
+	std::string Reconciler::makeKey(const Row& row, const Keys& keys,
+									const std::vector<bool>& numeric)
+	{
+		std::string key;
+		for(size_t i = 0; i < keys.indices.size(); ++i) {
+			int index = keys.indices[i];
+			std::string value{index < static_cast<int>(row.size()) ?
+					row[index] : Cell{}};
+
+			if (numeric[i] && !value.empty()) {
+				key += std::to_string(std::llround(std::strtod(value.c_str(), nullptr) * 100));
+			} else {
+				key += value;
+			}
+			key += '\x1f';
+		}
+		return key;
+	}
+
+	namespace {
+		// the right rows with the same keys ordered by date; the
+		// taken ones are skipped by following links to the next
+		// untaken one on either side, links which are shortened
+		// as they are followed
+		struct Candidates
+		{
+			std::vector<std::pair<int, int>> rows; // day and row number
+			std::vector<int> next;	// next[i]: first untaken from i, or size
+			std::vector<int> prev;	// prev[i + 1]: last untaken up to i, plus 1
+
+			void prepare()
+			{
+				std::sort(rows.begin(), rows.end());
+				next.resize(rows.size() + 1);
+				prev.resize(rows.size() + 1);
+				for(size_t i = 0; i <= rows.size(); ++i) {
+					next[i] = prev[i] = i;
+				}
+			}
+
+			static int follow(std::vector<int>& link, int i)
+			{
+				while (link[i] != i) {
+					link[i] = link[link[i]];
+					i = link[i];
+				}
+				return i;
+			}
+
+			int firstFrom(int i) { return follow(next, i); }
+			int lastBefore(int i) { return follow(prev, i) - 1; }
+
+			void take(int i)
+			{
+				next[i] = i + 1;
+				prev[i + 1] = i;
+			}
+		};
+	}
+
+	Reconciler::Result Reconciler::match(const Table& left, const Table& right) const
+	{
+		Result result;
+		if (left.empty() || right.empty()) {
+			return result;
+		}
+
+		const Keys& lKeys = leftIndices;
+		const Keys& rKeys = rightIndices;
+		std::vector<bool> numeric = numericKeys(left, lKeys, right, rKeys);
+
+		auto dayOf = [](const Row& row, int index, int& day) {
+			if (index < 0) {
+				day = 0; // no date: only the keys count
+				return true;
+			}
+			return index < static_cast<int>(row.size()) &&
+				Window::toDays(row[index], day);
+		};
+
+		// index the right rows on their keys:
+		std::vector<bool> taken(right.size());
+		std::unordered_map<std::string, Candidates> index;
+		for(int r = 1, e = right.size(); r < e; ++r) {
+			int day = 0;
+			if (!dayOf(right[r], rKeys.dateIndex, day)) {
+				continue; // can't be matched without a date
+			}
+			index[makeKey(right[r], rKeys, numeric)].rows.emplace_back(day, r);
+		}
+		for(auto& entry : index) {
+			entry.second.prepare();
+		}
+
+		// match each left row to the unmatched right row with
+		// the same keys that is the closest in time, the first
+		// one in the file if two are as close:
+		for(int l = 1, e = left.size(); l < e; ++l) {
+			int day = 0;
+			auto it = index.end();
+			if (dayOf(left[l], lKeys.dateIndex, day)) {
+				it = index.find(makeKey(left[l], lKeys, numeric));
+			}
+			if (it == index.end()) {
+				result.unmatchedLeft.push_back(l);
+				continue;
+			}
+
+			Candidates& candidates = it->second;
+			const auto& rows = candidates.rows;
+			int n = rows.size();
+			int from = std::lower_bound(rows.begin(), rows.end(),
+										std::make_pair(day, 0)) - rows.begin();
+
+			// the closest on or after the day:
+			int best = -1;
+			int after = candidates.firstFrom(from);
+			if (after < n && rows[after].first - day <= tolerance) {
+				best = after;
+			}
+
+			// and the first one of the closest day before it:
+			int before = candidates.lastBefore(from);
+			if (before >= 0 && day - rows[before].first <= tolerance) {
+				int first = std::lower_bound(rows.begin(), rows.end(),
+											 std::make_pair(rows[before].first, 0)) -
+					rows.begin();
+				before = candidates.firstFrom(first);
+				int distance = day - rows[before].first;
+				if (best < 0 || distance < rows[best].first - day ||
+					(distance == rows[best].first - day &&
+					 rows[before].second < rows[best].second)) {
+					best = before;
+				}
+			}
+
+			if (best < 0) {
+				result.unmatchedLeft.push_back(l);
+			} else {
+				candidates.take(best);
+				taken[rows[best].second] = true;
+				result.matched.emplace_back(l, rows[best].second);
+			}
+		}
+
+		for(int r = 1, e = right.size(); r < e; ++r) {
+			if (!taken[r]) {
+				result.unmatchedRight.push_back(r);
+			}
+		}
+		return result;
+	}
+
+} // namespace expenses
@@ -0,0 +1,69 @@
+#ifndef RECONCILE_H_
+#define RECONCILE_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "row.h"
+
+// Matching of the rows of two ledgers, e.g. a bank statement
+// against the books: rows match when their key columns are
+// equal and their dates are at most tolerance days apart
+namespace expenses {
+	class Reconciler
+	{
+	public:
+		struct Result
+		{
+			// row numbers in the left and right tables:
+			std::vector<std::pair<int, int>> matched;
+			std::vector<int> unmatchedLeft;
+			std::vector<int> unmatchedRight;
+		};
+
+		// a column is given as left:right when its name differs
+		// between the two tables; dateColumn may be empty
+		Reconciler(const ColumnList& keyColumns, const std::string& dateColumn,
+				   int tolerance);
+
+		// the positions in the rows of each table of the key
+		// columns and of the date, -1 without one; must be
+		// called before matching
+		void bind(const std::vector<int>& leftKeyIndices, int leftDateIndex,
+				  const std::vector<int>& rightKeyIndices, int rightDateIndex);
+
+		// the tables start with their headings
+		Result match(const Table& left, const Table& right) const;
+
+		// the columns used from each table, the date last
+		ColumnList getLeftColumns() const;
+		ColumnList getRightColumns() const;
+
+		// the names in each table of a column given as left:right
+		static std::pair<std::string, std::string> split(const std::string& column);
+
+	private:
+		struct Keys
+		{
+			std::vector<int> indices;
+			int dateIndex{-1};
+		};
+
+		static bool isDecimal(Cell value);
+		static std::vector<bool> numericKeys(const Table& left, const Keys& lKeys,
+											 const Table& right, const Keys& rKeys);
+		static std::string makeKey(const Row& row, const Keys& keys,
+								   const std::vector<bool>& numeric);
+		ColumnList leftKeys;
+		ColumnList rightKeys;
+		std::string leftDate;
+		std::string rightDate;
+		int tolerance;
+
+		Keys leftIndices;
+		Keys rightIndices;
+	};
+} // namespace expenses
+
+#endif
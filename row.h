@@ -0,0 +1,21 @@
+#ifndef ROW_H_
+#define ROW_H_
+
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace expenses {
+	// a row of the input: its cells are views of text owned by
+	// whoever loaded the row, for a table the arena it was
+	// loaded into
+	using Cell = std::string_view;
+	using Row = std::pmr::vector<Cell>;
+	using Table = std::vector<Row>;
+
+	// names of columns, as given in the options
+	using ColumnList = std::vector<std::string>;
+} // namespace expenses
+
+#endif
@@ -0,0 +1,216 @@
+#include "sketch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace expenses {
+
+	QuantileSketch::QuantileSketch(bool exact, int k) :
+		levels(1), k{k}, exact{exact}
+	{
+		maxStored = capacity(0);
+	}
+
+	// the top level holds k items, each level below 2/3 of
+	// the one above it but never less than 2
+	int QuantileSketch::capacity(int level) const
+	{
+		int depth = levels.size() - 1 - level;
+		return std::max(2, static_cast<int>(std::ceil(k * std::pow(2.0 / 3.0, depth))));
+	}
+
+	void QuantileSketch::updateMaxStored()
+	{
+		maxStored = 0;
+		for(int h = 0, e = levels.size(); h != e; ++h) {
+			maxStored += capacity(h);
+		}
+	}
+
+	void QuantileSketch::add(double value)
+	{
+		levels[0].push_back(value);
+		++n;
+		++stored;
+		if (!exact && static_cast<int>(stored) > maxStored) {
+			compress();
+		}
+	}
+
+	void QuantileSketch::merge(const QuantileSketch& other)
+	{
+		if (levels.size() < other.levels.size()) {
+			levels.resize(other.levels.size());
+			updateMaxStored();
+		}
+		for(size_t h = 0; h < other.levels.size(); ++h) {
+			levels[h].insert(levels[h].end(), other.levels[h].begin(),
+							 other.levels[h].end());
+		}
+		n += other.n;
+		stored += other.stored;
+		exact = exact && other.exact;
+		if (!exact) {
+			compress();
+		}
+	}
+
+	void QuantileSketch::compress()
+	{
+		for(int h = 0; h < static_cast<int>(levels.size()); ++h) {
+			if (static_cast<int>(stored) <= maxStored) {
+				return;
+			}
+
+			if (static_cast<int>(levels[h].size()) < capacity(h)) {
+				continue;
+			}
+
+			if (h + 1 == static_cast<int>(levels.size())) {
+				levels.emplace_back();
+				updateMaxStored();
+			}
+
+			// promote every other item of the sorted level, starting
+			// with the first or the second one at random; an odd
+			// item out stays where it is
+			std::vector<double>& level = levels[h];
+			std::vector<double>& up = levels[h + 1];
+			std::sort(level.begin(), level.end());
+			double spare = 0;
+			bool hasSpare = level.size() % 2 != 0;
+			if (hasSpare) {
+				spare = level.back();
+				level.pop_back();
+			}
+
+			seed ^= seed << 13;
+			seed ^= seed >> 7;
+			seed ^= seed << 17;
+			for(size_t i = seed & 1; i < level.size(); i += 2) {
+				up.push_back(level[i]);
+			}
+			stored -= level.size() / 2;
+			level.clear();
+			if (hasSpare) {
+				level.push_back(spare);
+			}
+		}
+	}
+
+	double QuantileSketch::quantile(double q) const
+	{
+		if (n == 0) {
+			return std::numeric_limits<double>::quiet_NaN();
+		}
+
+		std::vector<std::pair<double, uint64_t>> items;
+		items.reserve(stored);
+		uint64_t weight = 1;
+		for(const auto& level : levels) {
+			for(double value : level) {
+				items.emplace_back(value, weight);
+			}
+			weight *= 2;
+		}
+		std::sort(items.begin(), items.end());
+
+		uint64_t total = 0;
+		for(const auto& item : items) {
+			total += item.second;
+		}
+
+		// nearest rank:
+		q = std::min(1.0, std::max(0.0, q));
+		uint64_t rank = std::max<uint64_t>(1, std::ceil(q * total));
+		uint64_t seen = 0;
+		for(const auto& item : items) {
+			seen += item.second;
+			if (seen >= rank) {
+				return item.first;
+			}
+		}
+		return items.back().first;
+	}
+
+	void DistinctSketch::add(uint64_t hash)
+	{
+		if (!registers.empty()) {
+			addToRegisters(hash);
+			return;
+		}
+
+		hashes.insert(hash);
+		if (!exact && hashes.size() > exactLimit) {
+			toRegisters();
+		}
+	}
+
+	void DistinctSketch::merge(const DistinctSketch& other)
+	{
+		exact = exact && other.exact;
+		if (!other.registers.empty()) {
+			if (registers.empty()) {
+				toRegisters();
+			}
+			for(size_t i = 0; i < registers.size(); ++i) {
+				registers[i] = std::max(registers[i], other.registers[i]);
+			}
+			return;
+		}
+
+		for(uint64_t hash : other.hashes) {
+			add(hash);
+		}
+	}
+
+	void DistinctSketch::toRegisters()
+	{
+		registers.assign(size_t{1} << precision, 0);
+		for(uint64_t hash : hashes) {
+			addToRegisters(hash);
+		}
+		hashes = {};
+	}
+
+	void DistinctSketch::addToRegisters(uint64_t hash)
+	{
+		// the first bits pick the register, the position of the
+		// first 1 bit in the rest is the rank; the guard bit
+		// bounds the rank
+		size_t index = hash >> (64 - precision);
+		uint64_t rest = (hash << precision) | (uint64_t{1} << (precision - 1));
+		uint8_t rank = 1;
+		for(; !(rest & (uint64_t{1} << 63)); rest <<= 1) {
+			++rank;
+		}
+		registers[index] = std::max(registers[index], rank);
+	}
+
+	double DistinctSketch::estimate() const
+	{
+		if (registers.empty()) {
+			return hashes.size();
+		}
+
+		double m = registers.size();
+		double sum = 0;
+		int zeros = 0;
+		for(uint8_t r : registers) {
+			sum += std::ldexp(1.0, -r);
+			zeros += r == 0;
+		}
+
+		double alpha = 0.7213 / (1 + 1.079 / m);
+		double e = alpha * m * m / sum;
+
+		// small range correction: linear counting
+		if (e <= 2.5 * m && zeros != 0) {
+			e = m * std::log(m / zeros);
+		}
+		return e;
+	}
+
+} // namespace expenses
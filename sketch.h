@@ -0,0 +1,71 @@
+#ifndef SKETCH_H_
+#define SKETCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+// Constant memory, mergeable summaries of a stream of values
+namespace expenses {
+
+	// KLL quantile sketch: values are kept in a hierarchy of
+	// compactors, an item on level h standing for 2^h values.
+	// Nothing is compacted until the sketch is full, so small
+	// inputs are answered exactly; in exact mode nothing is
+	// ever compacted
+	class QuantileSketch
+	{
+	public:
+		explicit QuantileSketch(bool exact = false, int k = 200);
+
+		void add(double value);
+		void merge(const QuantileSketch& other);
+
+		// the value of rank q times the number of values, q in
+		// [0, 1]; NaN if empty
+		double quantile(double q) const;
+
+	private:
+		int capacity(int level) const;
+		void updateMaxStored();
+		void compress();
+
+		std::vector<std::vector<double>> levels;
+		uint64_t n{0};
+		size_t stored{0};
+		int maxStored{0};
+		int k;
+		bool exact;
+
+		// compaction coin flips; seeded so that runs are repeatable
+		uint64_t seed{0x2545f4914f6cdd1dULL};
+	};
+
+	// HyperLogLog distinct counter over 64 bit hashes; the hashes
+	// themselves are kept (an exact count) until there are more
+	// than exactLimit of them, unless in exact mode
+	class DistinctSketch
+	{
+	public:
+		static constexpr int precision = 12;
+		static constexpr size_t exactLimit = 1024;
+
+		explicit DistinctSketch(bool exact = false) : exact{exact} {}
+
+		void add(uint64_t hash);
+		void merge(const DistinctSketch& other);
+		double estimate() const;
+
+	private:
+		void toRegisters();
+		void addToRegisters(uint64_t hash);
+
+		std::unordered_set<uint64_t> hashes;
+		std::vector<uint8_t> registers;
+		bool exact;
+	};
+
+} // namespace expenses
+
+#endif
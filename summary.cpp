@@ -0,0 +1,171 @@
+#include "summary.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace expenses {
+
+	Summary::Summary(const std::vector<AggregateSpec>& specs, const std::string& codeColumn,
+					 bool exact) :
+		specs{specs}, codeColumn{codeColumn}, exact{exact}
+	{
+	}
+
+	void Summary::bind(int codeIndex, const std::vector<int>& indices)
+	{
+		this->codeIndex = codeIndex;
+		this->indices = indices;
+	}
+
+	Summary::Group Summary::makeGroup() const
+	{
+		Group group;
+		group.reserve(specs.size());
+		for(const auto& spec : specs) {
+			group.emplace_back(spec, exact);
+		}
+		return group;
+	}
+
+	void Summary::add(const Row& row)
+	{
+		// without a code column nothing can be summarized:
+		if (codeIndex < 0) {
+			return;
+		}
+
+		Cell code = codeIndex < static_cast<int>(row.size()) ? row[codeIndex] : Cell{};
+
+		auto it = groups.find(code);
+		if (it == groups.end()) {
+			it = groups.emplace(intern(code), makeGroup()).first;
+		}
+
+		Group& group = it->second;
+		for(int i = 0, e = indices.size(); i != e; ++i) {
+			int index = indices[i];
+			if (index >= 0 && index < static_cast<int>(row.size())) {
+				group[i].add(row[index]);
+			}
+		}
+	}
+
+	void Summary::merge(const Summary& other)
+	{
+		for(const auto& entry : other.groups) {
+			auto it = groups.find(entry.first);
+			if (it == groups.end()) {
+				groups.emplace(intern(entry.first), entry.second);
+				continue;
+			}
+
+			for(size_t i = 0; i < specs.size(); ++i) {
+				it->second[i].merge(entry.second[i]);
+			}
+		}
+	}
+
+	std::string_view Summary::intern(std::string_view code)
+	{
+		char* text = static_cast<char*>(arena->allocate(code.empty() ? 1 : code.size(), 1));
+		std::memcpy(text, code.data(), code.size());
+		return {text, code.size()};
+	}
+
+	// a summary of the same columns without any row yet
+	Summary Summary::makeEmpty() const
+	{
+		Summary summary{specs, codeColumn, exact};
+		summary.bind(codeIndex, indices);
+		return summary;
+	}
+
+	void Summary::addRows(Table::const_iterator first, Table::const_iterator last,
+						  unsigned threads)
+	{
+		threads = std::max(threads, 1u);
+		size_t chunks = (last - first + chunkSize - 1) / chunkSize;
+
+		// one round of up to threads chunks at a time:
+		for(size_t chunk = 0; chunk < chunks; chunk += threads) {
+			size_t round = std::min<size_t>(threads, chunks - chunk);
+			std::vector<Summary> partials;
+			partials.reserve(round);
+			for(size_t i = 0; i < round; ++i) {
+				partials.push_back(makeEmpty());
+			}
+			auto aggregate = [&partials, first, last, chunk](size_t i) {
+				auto begin = first + (chunk + i) * chunkSize;
+				auto end = last - begin > static_cast<long>(chunkSize) ?
+					begin + chunkSize : last;
+				for(auto it = begin; it != end; ++it) {
+					partials[i].add(*it);
+				}
+			};
+
+			// this thread takes the first chunk of the round:
+			std::vector<std::thread> workers;
+			for(size_t i = 1; i < round; ++i) {
+				workers.emplace_back(aggregate, i);
+			}
+			aggregate(0);
+			for(auto& worker : workers) {
+				worker.join();
+			}
+
+			for(const auto& partial : partials) {
+				merge(partial);
+			}
+		}
+	}
+
+	ColumnList Summary::getCodes() const
+	{
+		ColumnList codes;
+		for(const auto& entry : groups) {
+			if (!entry.first.empty()) {
+				codes.push_back(std::string{entry.first});
+			}
+		}
+		std::sort(codes.begin(), codes.end());
+		return codes;
+	}
+
+	std::vector<double> Summary::getResults(const std::string& code) const
+	{
+		auto it = groups.find(code);
+		return it != groups.end() ? resultsOf(it->second) : resultsOf(makeGroup());
+	}
+
+	std::vector<double> Summary::resultsOf(const Group& group)
+	{
+		std::vector<double> results;
+		for(const auto& aggregate : group) {
+			results.push_back(aggregate.result());
+		}
+		return results;
+	}
+
+	std::vector<double> Summary::getTotals() const
+	{
+		// merge in code order so that the totals do not depend
+		// on the layout of the hash table:
+		ColumnList codes = getCodes();
+		codes.insert(codes.begin(), "");
+
+		Group total = makeGroup();
+		for(const auto& code : codes) {
+			auto it = groups.find(code);
+			if (it == groups.end()) {
+				continue;
+			}
+			for(size_t i = 0; i < specs.size(); ++i) {
+				total[i].merge(it->second[i]);
+			}
+		}
+
+		return resultsOf(total);
+	}
+
+} // namespace expenses
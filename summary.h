@@ -0,0 +1,70 @@
+#ifndef SUMMARY_H_
+#define SUMMARY_H_
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "aggregate.h"
+#include "row.h"
+
+// Single pass group-by of the rows on the financial code
+namespace expenses {
+	class Summary
+	{
+	public:
+		Summary(const std::vector<AggregateSpec>& specs, const std::string& codeColumn,
+				bool exact);
+
+		// the positions in the rows of the code and of the column
+		// of each spec; must be called before any row is added
+		void bind(int codeIndex, const std::vector<int>& indices);
+		void add(const Row& row);
+		void merge(const Summary& other);
+
+		// add the rows in chunks of chunkSize rows, each one
+		// aggregated into a table of its own by one of up to
+		// threads threads; the tables are merged in the order
+		// of the chunks so the result does not depend on the
+		// number of threads
+		static constexpr size_t chunkSize = 16 * 1024;
+		void addRows(Table::const_iterator first, Table::const_iterator last,
+					 unsigned threads);
+
+		const std::vector<AggregateSpec>& getSpecs() const { return specs; }
+		const std::string& getCodeColumn() const { return codeColumn; }
+
+		// the codes seen, sorted, and the aggregate values for
+		// one of them or for all the rows
+		ColumnList getCodes() const;
+		std::vector<double> getResults(const std::string& code) const;
+		std::vector<double> getTotals() const;
+
+	private:
+		using Group = std::vector<Aggregate>;
+		Group makeGroup() const;
+		Summary makeEmpty() const;
+		std::string_view intern(std::string_view code);
+		static std::vector<double> resultsOf(const Group& group);
+
+		std::vector<AggregateSpec> specs;
+		std::string codeColumn;
+		bool exact;
+
+		int codeIndex{-1};
+		std::vector<int> indices;
+
+		// rows without a code are kept under "" and only
+		// show up in the totals; the codes are views of copies
+		// kept in the arena so that looking up the code of a
+		// row allocates nothing
+		std::unique_ptr<std::pmr::monotonic_buffer_resource> arena{
+			new std::pmr::monotonic_buffer_resource};
+		std::unordered_map<std::string_view, Group> groups;
+	};
+} // namespace expenses
+
+#endif
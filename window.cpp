@@ -0,0 +1,187 @@
+#include "window.h"
+
+#include <limits>
+#include <stdexcept>
+
+#include "aggregate.h"
+
+namespace expenses {
+
+	WindowSpec WindowSpec::parse(const std::string& text)
+	{
+		WindowSpec spec;
+		spec.label = text;
+
+		size_t open = text.find('(');
+		if (open == std::string::npos || text.back() != ')') {
+			throw std::runtime_error{"Invalid window: " + text};
+		}
+
+		std::string fn = text.substr(0, open);
+		std::string args = text.substr(open + 1, text.size() - open - 2);
+		size_t comma = args.find(',');
+		spec.column = args.substr(0, comma);
+
+		if (fn == "cumsum") {
+			spec.kind = RunningSum;
+			return spec;
+		} else if (fn == "msum") {
+			spec.kind = MovingSum;
+		} else if (fn == "mavg") {
+			spec.kind = MovingAvg;
+		} else {
+			throw std::runtime_error{"Unknown window function: " + text};
+		}
+
+		// the size of a moving window, and the column of its dates:
+		std::string size = comma == std::string::npos ? "" : args.substr(comma + 1);
+		size_t dateComma = size.find(',');
+		if (dateComma != std::string::npos) {
+			spec.date = size.substr(dateComma + 1);
+			size.erase(dateComma);
+		}
+		if (!size.empty() && size.back() == 'd') {
+			spec.days = true;
+			size.pop_back();
+		}
+		try {
+			size_t n = 0;
+			spec.size = std::stoi(size, &n);
+			if (n != size.size() || spec.size <= 0) {
+				throw std::invalid_argument{size};
+			}
+		} catch(const std::exception& e) {
+			throw std::runtime_error{"Invalid window size: " + text};
+		}
+		if (!spec.date.empty() && !spec.days) {
+			throw std::runtime_error{"A window in rows has no date column: " + text};
+		}
+
+		return spec;
+	}
+
+	Window::Window(const std::vector<WindowSpec>& specs) :
+		specs{specs}
+	{
+	}
+
+	void Window::bind(int partitionIndex, const std::vector<int>& dateIndices,
+					  const std::vector<int>& indices)
+	{
+		this->partitionIndex = partitionIndex;
+		this->dateIndices = dateIndices;
+		this->indices = indices;
+	}
+
+	std::vector<double> Window::next(const Row& row)
+	{
+		const double none = std::numeric_limits<double>::quiet_NaN();
+		auto cell = [&row](int index) {
+			return index >= 0 && index < static_cast<int>(row.size()) ?
+				row[index] : Cell{};
+		};
+
+		std::string partition{cell(partitionIndex)};
+		auto it = partitions.find(partition);
+		if (it == partitions.end()) {
+			it = partitions.emplace(partition, std::vector<State>(specs.size())).first;
+		}
+		std::vector<State>& states = it->second;
+
+		std::vector<double> values(specs.size(), none);
+		for(int i = 0, e = specs.size(); i != e; ++i) {
+			const WindowSpec& spec = specs[i];
+			State& state = states[i];
+			int position = state.rows++;
+
+			// a window in days over a column that does not hold
+			// dates would be empty on every row:
+			int day = 0;
+			if (spec.days) {
+				Cell date = cell(dateIndices[i]);
+				if (date.empty()) {
+					continue; // no date, no window
+				}
+				if (!toDays(date, day)) {
+					throw std::runtime_error{"Column " + spec.date + " of window " +
+							spec.label + " does not hold dates: " + std::string{date}};
+				}
+			}
+
+			double dVal = 0;
+			bool hasValue = Aggregate::toNumber(cell(indices[i]), dVal);
+			if (spec.kind == WindowSpec::RunningSum) {
+				state.sum += hasValue ? dVal : 0;
+				values[i] = state.sum;
+				continue;
+			}
+
+			// slide the window: it ends at this row and spans
+			// the last size rows or days
+			int key = spec.days ? day : position;
+			if (hasValue) {
+				state.items.emplace_back(key, dVal);
+				state.sum += dVal;
+			}
+			while (!state.items.empty() && state.items.front().first <= key - spec.size) {
+				state.sum -= state.items.front().second;
+				state.items.pop_front();
+			}
+
+			if (spec.kind == WindowSpec::MovingSum) {
+				values[i] = state.items.empty() ? 0 : state.sum;
+			} else if (!state.items.empty()) {
+				values[i] = state.sum / state.items.size();
+			}
+		}
+
+		return values;
+	}
+
+	bool Window::toDays(std::string_view text, int& days)
+	{
+		// same format as the dates recognized for sorting:
+		std::string str{text};
+		size_t first = str.find_first_of("-/");
+		if (first == std::string::npos) {
+			return false;
+		}
+		size_t second = str.find(str[first], first + 1);
+		if (second == std::string::npos) {
+			return false;
+		}
+
+		int y, m, d;
+		try {
+			size_t n = 0;
+			y = std::stoi(str.substr(0, first), &n);
+			if (n != first) {
+				return false;
+			}
+			m = std::stoi(str.substr(first + 1, second - first - 1), &n);
+			if (n != second - first - 1) {
+				return false;
+			}
+			d = std::stoi(str.substr(second + 1), &n);
+			if (n != str.size() - second - 1) {
+				return false;
+			}
+		} catch(const std::exception& e) {
+			return false;
+		}
+
+		if (y < 100) {
+			y += 2000;
+		}
+
+		// days from the civil date (proleptic Gregorian calendar):
+		y -= m <= 2;
+		int era = (y >= 0 ? y : y - 399) / 400;
+		int yoe = y - era * 400;
+		int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+		int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+		days = era * 146097 + doe - 719468;
+		return true;
+	}
+
+} // namespace expenses
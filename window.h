@@ -0,0 +1,79 @@
+#ifndef WINDOW_H_
+#define WINDOW_H_
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "row.h"
+
+// Window functions over the ordered rows of the detail listing;
+// every row updates a sliding window per partition so the whole
+// listing is computed in one pass
+namespace expenses {
+
+	// a window column as given on the command line:
+	//   cumsum(column)      running sum
+	//   msum(column,N)      moving sum over the last N rows
+	//   mavg(column,N)      moving average over the last N rows
+	// N can also be given in days, e.g. msum(Amount,30d), over the
+	// dates of the first column ordered by or of the column given
+	// after it, e.g. msum(Amount,30d,Date)
+	struct WindowSpec
+	{
+		enum Kind { RunningSum, MovingSum, MovingAvg };
+
+		Kind kind{RunningSum};
+		std::string column;
+		int size{0};
+		bool days{false};
+		std::string date;	// the column of the dates of a window in days
+		std::string label;
+
+		static WindowSpec parse(const std::string& text);
+	};
+
+	class Window
+	{
+	public:
+		explicit Window(const std::vector<WindowSpec>& specs);
+
+		// the positions in the rows of the partition and, for each
+		// window, of its dates if it is in days and of its column;
+		// -1 for a missing one. Must be called before any row is added
+		void bind(int partitionIndex, const std::vector<int>& dateIndices,
+				  const std::vector<int>& indices);
+		const std::vector<WindowSpec>& getSpecs() const { return specs; }
+
+		// add the next row, in order, and get the value of each
+		// window for it; NaN when it has none. Throws if the dates
+		// of a window in days are not dates
+		std::vector<double> next(const Row& row);
+
+		// the number of days since 1970-01-01 of a YYYY-MM-DD,
+		// YYYY/MM/DD, YY-MM-DD or YY/MM/DD date
+		static bool toDays(std::string_view str, int& days);
+
+	private:
+		struct State
+		{
+			// (row number or day, value) of the values in the window:
+			std::deque<std::pair<int, double>> items;
+			double sum{0};
+			int rows{0};
+		};
+
+		std::vector<WindowSpec> specs;
+
+		int partitionIndex{-1};
+		std::vector<int> dateIndices;
+		std::vector<int> indices;
+
+		std::unordered_map<std::string, std::vector<State>> partitions;
+	};
+
+} // namespace expenses
+
+#endif